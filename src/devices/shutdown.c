@@ -5,10 +5,16 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/vmstat.h"
+#include "vm/zswap.h"
+#endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "filesys/filesys.h"
@@ -138,4 +144,10 @@ print_stats (void)
 #ifdef USERPROG
   exception_print_stats ();
 #endif
+#ifdef VM
+  frame_print_stats ();
+  vmstat_print_stats ();
+  zswap_print_stats ();
+#endif
+  slab_print_stats ();
 }
@@ -0,0 +1,164 @@
+#include "filesys/cache.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+
+/* A small write-through cache of file system sectors, used for the
+   parts of sectors at either end of a transfer.  Whole sectors go
+   straight between the block device and the caller's buffer and
+   never pass through here.  A run of small sequential reads or
+   writes thus touches the disk once per sector for reading, and
+   no transfer needs a bounce buffer. */
+
+/* Number of cached sectors. */
+#define CACHE_SIZE 16
+
+/* A cached sector.  SECTOR, VALID, ACCESSED and USERS belong to
+   cache_lock, which only covers lookup and replacement.  DATA
+   belongs to LOCK, which is held across the disk transfer, so
+   I/O on one sector does not hold up the others. */
+struct cache_entry
+  {
+    block_sector_t sector;              /* Sector held. */
+    bool valid;                         /* False if the slot is empty. */
+    bool accessed;                      /* Used since the hand passed. */
+    int users;                          /* Threads using DATA. */
+    struct lock lock;                   /* Protects DATA. */
+    uint8_t data[BLOCK_SECTOR_SIZE];    /* Sector contents. */
+  };
+
+static struct cache_entry cache[CACHE_SIZE];
+static struct lock cache_lock;          /* Protects the fields above. */
+static struct condition cache_idle;     /* Some entry's USERS fell to 0. */
+static size_t cache_hand;               /* Clock hand for replacement. */
+
+static struct cache_entry *cache_get (block_sector_t);
+static void cache_put (struct cache_entry *);
+
+/* Initializes the sector cache. */
+void
+cache_init (void)
+{
+  size_t i;
+
+  lock_init (&cache_lock);
+  cond_init (&cache_idle);
+  for (i = 0; i < CACHE_SIZE; i++)
+    lock_init (&cache[i].lock);
+}
+
+/* Copies SIZE bytes at SECTOR_OFS within SECTOR into BUFFER. */
+void
+cache_read (block_sector_t sector, void *buffer, int sector_ofs, int size)
+{
+  struct cache_entry *e;
+
+  ASSERT (sector_ofs >= 0 && sector_ofs + size <= BLOCK_SECTOR_SIZE);
+
+  e = cache_get (sector);
+  memcpy (buffer, e->data + sector_ofs, size);
+  cache_put (e);
+}
+
+/* Copies SIZE bytes from BUFFER to SECTOR_OFS within SECTOR, and
+   writes the sector through to disk. */
+void
+cache_write (block_sector_t sector, const void *buffer, int sector_ofs,
+             int size)
+{
+  struct cache_entry *e;
+
+  ASSERT (sector_ofs >= 0 && sector_ofs + size <= BLOCK_SECTOR_SIZE);
+
+  e = cache_get (sector);
+  memcpy (e->data + sector_ofs, buffer, size);
+  block_write (fs_device, sector, e->data);
+  cache_put (e);
+}
+
+/* Drops any cached copy of SECTOR, which is about to be written
+   directly on disk.  Waits for anyone still using the copy. */
+void
+cache_invalidate (block_sector_t sector)
+{
+  size_t i;
+
+  lock_acquire (&cache_lock);
+  for (i = 0; i < CACHE_SIZE; i++)
+    if (cache[i].valid && cache[i].sector == sector)
+      {
+        while (cache[i].users > 0)
+          cond_wait (&cache_idle, &cache_lock);
+        cache[i].valid = false;
+      }
+  lock_release (&cache_lock);
+}
+
+/* Returns the entry holding SECTOR, with its lock held, reading
+   the sector in over an entry chosen by the clock algorithm if it
+   is not cached.  Only the lookup and the choice of entry happen
+   under cache_lock; the read does not.  Release the entry with
+   cache_put(). */
+static struct cache_entry *
+cache_get (block_sector_t sector)
+{
+  struct cache_entry *e;
+  size_t i;
+
+  lock_acquire (&cache_lock);
+  for (;;)
+    {
+      for (i = 0; i < CACHE_SIZE; i++)
+        if (cache[i].valid && cache[i].sector == sector)
+          {
+            e = &cache[i];
+            e->accessed = true;
+            e->users++;
+            lock_release (&cache_lock);
+            lock_acquire (&e->lock);
+            return e;
+          }
+
+      /* Two turns of the hand clear every accessed bit, so an
+         entry nobody is using turns up if there is one. */
+      for (i = 0; i < 2 * CACHE_SIZE; i++)
+        {
+          e = &cache[cache_hand];
+          cache_hand = (cache_hand + 1) % CACHE_SIZE;
+          if (e->users > 0)
+            continue;
+          if (!e->valid || !e->accessed)
+            {
+              /* Nobody holds the lock of an entry without users,
+                 so this does not block.  Taking it before
+                 cache_lock is dropped keeps other threads that
+                 find SECTOR out until it has been read. */
+              e->sector = sector;
+              e->valid = true;
+              e->accessed = true;
+              e->users = 1;
+              lock_acquire (&e->lock);
+              lock_release (&cache_lock);
+              block_read (fs_device, sector, e->data);
+              return e;
+            }
+          e->accessed = false;
+        }
+
+      /* Every entry is in use.  Another thread may have brought
+         SECTOR in by the time one frees up, so look again. */
+      cond_wait (&cache_idle, &cache_lock);
+    }
+}
+
+/* Releases entry E obtained from cache_get(). */
+static void
+cache_put (struct cache_entry *e)
+{
+  lock_release (&e->lock);
+  lock_acquire (&cache_lock);
+  if (--e->users == 0)
+    cond_broadcast (&cache_idle, &cache_lock);
+  lock_release (&cache_lock);
+}
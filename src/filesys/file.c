@@ -41,6 +41,22 @@ file_reopen (struct file *file)
   return file_open (inode_reopen (file->inode));
 }
 
+/* Opens and returns a new file for the same inode as FILE, with
+   the same position and write denial.  Returns a null pointer if
+   unsuccessful. */
+struct file *
+file_duplicate (struct file *file) 
+{
+  struct file *copy = file_reopen (file);
+  if (copy != NULL)
+    {
+      copy->pos = file->pos;
+      if (file->deny_write)
+        file_deny_write (copy);
+    }
+  return copy;
+}
+
 /* Closes FILE. */
 void
 file_close (struct file *file) 
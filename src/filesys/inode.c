@@ -3,9 +3,11 @@
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -36,6 +38,7 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    struct rwlock rwlock;               /* Readers share, writers own. */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -54,14 +57,18 @@ byte_to_sector (const struct inode *inode, off_t pos)
 }
 
 /* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
+   returns the same `struct inode'.  OPEN_INODES_LOCK protects the
+   list and each inode's open_cnt; an inode's data is protected by
+   its own rwlock, so I/O on different files does not contend. */
 static struct list open_inodes;
+static struct lock open_inodes_lock;
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  lock_init (&open_inodes_lock);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -96,7 +103,10 @@ inode_create (block_sector_t sector, off_t length)
               size_t i;
               
               for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
+                {
+                  cache_invalidate (disk_inode->start + i);
+                  block_write (fs_device, disk_inode->start + i, zeros);
+                }
             }
           success = true; 
         } 
@@ -115,13 +125,15 @@ inode_open (block_sector_t sector)
   struct inode *inode;
 
   /* Check whether this inode is already open. */
+  lock_acquire (&open_inodes_lock);
   for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
        e = list_next (e)) 
     {
       inode = list_entry (e, struct inode, elem);
       if (inode->sector == sector) 
         {
-          inode_reopen (inode);
+          inode->open_cnt++;
+          lock_release (&open_inodes_lock);
           return inode; 
         }
     }
@@ -129,7 +141,10 @@ inode_open (block_sector_t sector)
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-    return NULL;
+    {
+      lock_release (&open_inodes_lock);
+      return NULL;
+    }
 
   /* Initialize. */
   list_push_front (&open_inodes, &inode->elem);
@@ -137,7 +152,9 @@ inode_open (block_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
+  rwlock_init (&inode->rwlock);
   block_read (fs_device, inode->sector, &inode->data);
+  lock_release (&open_inodes_lock);
   return inode;
 }
 
@@ -146,7 +163,11 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      lock_acquire (&open_inodes_lock);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+    }
   return inode;
 }
 
@@ -163,16 +184,22 @@ inode_get_inumber (const struct inode *inode)
 void
 inode_close (struct inode *inode) 
 {
+  bool last;
+
   /* Ignore null pointer. */
   if (inode == NULL)
     return;
 
+  /* Remove from inode list if this was the last opener. */
+  lock_acquire (&open_inodes_lock);
+  last = --inode->open_cnt == 0;
+  if (last)
+    list_remove (&inode->elem);
+  lock_release (&open_inodes_lock);
+
   /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  if (last)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
- 
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
@@ -202,8 +229,8 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
 
+  rwlock_acquire_read (&inode->rwlock);
   while (size > 0) 
     {
       /* Disk sector to read, starting byte offset within sector. */
@@ -227,16 +254,9 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
         }
       else 
         {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-          block_read (fs_device, sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
+          /* Copy part of the sector out of the cache. */
+          cache_read (sector_idx, buffer + bytes_read, sector_ofs,
+                      chunk_size);
         }
       
       /* Advance. */
@@ -244,7 +264,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
+  rwlock_release_read (&inode->rwlock);
 
   return bytes_read;
 }
@@ -260,10 +280,13 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
 
+  rwlock_acquire_write (&inode->rwlock);
   if (inode->deny_write_cnt)
-    return 0;
+    {
+      rwlock_release_write (&inode->rwlock);
+      return 0;
+    }
 
   while (size > 0) 
     {
@@ -284,27 +307,15 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
           /* Write full sector directly to disk. */
+          cache_invalidate (sector_idx);
           block_write (fs_device, sector_idx, buffer + bytes_written);
         }
       else 
         {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
-          else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
+          /* Merge into the cached sector, which is written
+             through. */
+          cache_write (sector_idx, buffer + bytes_written, sector_ofs,
+                       chunk_size);
         }
 
       /* Advance. */
@@ -312,7 +323,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
+  rwlock_release_write (&inode->rwlock);
 
   return bytes_written;
 }
@@ -322,8 +333,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 void
 inode_deny_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rwlock);
   inode->deny_write_cnt++;
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
+  rwlock_release_write (&inode->rwlock);
 }
 
 /* Re-enables writes to INODE.
@@ -332,9 +345,11 @@ inode_deny_write (struct inode *inode)
 void
 inode_allow_write (struct inode *inode) 
 {
+  rwlock_acquire_write (&inode->rwlock);
   ASSERT (inode->deny_write_cnt > 0);
   ASSERT (inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
+  rwlock_release_write (&inode->rwlock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
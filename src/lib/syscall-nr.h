@@ -28,7 +28,21 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_FORK,                   /* Duplicate the calling process. */
+    SYS_RSS_LIMIT,              /* Set the resident set limit. */
+    SYS_MMAP_POPULATE,          /* Map a file and read it in now. */
+    SYS_MSYNC,                  /* Write back part of a mapping. */
+    SYS_MADVISE,                /* Give paging hints for a range. */
+    SYS_VMSTAT,                 /* Read virtual memory counters. */
+    SYS_READV,                  /* Read into several buffers. */
+    SYS_WRITEV,                 /* Write from several buffers. */
+    SYS_PREAD,                  /* Read at a given file offset. */
+    SYS_PWRITE,                 /* Write at a given file offset. */
+    SYS_AIO_SETUP,              /* Register an asynchronous I/O ring. */
+    SYS_AIO_ENTER               /* Submit and wait for ring requests. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -61,6 +61,25 @@
           retval;                                               \
         })
 
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; "    \
+             "pushl %[arg0]; pushl %[number]; int $0x30; "      \
+             "addl $20, %%esp"                                  \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "r" (ARG0),                             \
+                 [arg1] "r" (ARG1),                             \
+                 [arg2] "r" (ARG2),                             \
+                 [arg3] "r" (ARG3)                              \
+               : "memory");                                     \
+          retval;                                               \
+        })
+
 void
 halt (void) 
 {
@@ -182,3 +201,75 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+pid_t
+fork (void)
+{
+  return (pid_t) syscall0 (SYS_FORK);
+}
+
+unsigned
+rss_limit (unsigned pages)
+{
+  return syscall1 (SYS_RSS_LIMIT, pages);
+}
+
+mapid_t
+mmap_populate (int fd, void *addr)
+{
+  return syscall2 (SYS_MMAP_POPULATE, fd, addr);
+}
+
+bool
+msync (mapid_t mapid, size_t offset, size_t length)
+{
+  return syscall3 (SYS_MSYNC, mapid, offset, length);
+}
+
+bool
+madvise (void *addr, size_t length, int advice)
+{
+  return syscall3 (SYS_MADVISE, addr, length, advice);
+}
+
+void
+vmstat (struct vmstat *stat)
+{
+  syscall1 (SYS_VMSTAT, stat);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+bool
+aio_setup (struct aio_ring *ring)
+{
+  return syscall1 (SYS_AIO_SETUP, ring);
+}
+
+int
+aio_enter (unsigned to_submit, unsigned min_complete)
+{
+  return syscall2 (SYS_AIO_ENTER, to_submit, min_complete);
+}
@@ -2,6 +2,7 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <debug.h>
 
 /* Process identifier. */
@@ -45,4 +46,107 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Paging hints for madvise(). */
+#define MADV_NORMAL 0           /* No special treatment. */
+#define MADV_RANDOM 1           /* Expect random access; no readahead. */
+#define MADV_SEQUENTIAL 2       /* Expect one sequential pass. */
+#define MADV_WILLNEED 3         /* Read the range in now. */
+#define MADV_DONTNEED 4         /* Drop the range's pages. */
+
+/* Virtual memory counters returned by vmstat().  Times are in
+   timer ticks. */
+#define VMSTAT_BUCKETS 8        /* Fault latency histogram buckets. */
+
+struct vmstat
+  {
+    /* The calling process. */
+    unsigned long long minflt;          /* Faults served without I/O. */
+    unsigned long long majflt;          /* Faults that read from disk. */
+
+    /* All processes since boot. */
+    unsigned long long all_minflt;
+    unsigned long long all_majflt;
+    unsigned long long evict_clean;     /* Dropped; zero-filled later. */
+    unsigned long long evict_file;      /* Dropped; reread from file. */
+    unsigned long long evict_dirty;     /* Written back to the file. */
+    unsigned long long evict_swap;      /* Written to swap. */
+    unsigned long long swap_in;         /* Pages read from swap disk. */
+    unsigned long long swap_out;        /* Pages written to swap disk. */
+    long long swap_in_ticks;
+    long long swap_out_ticks;
+    unsigned long long frame_lock_cnt;  /* Frame table lock acquires. */
+    unsigned long long frame_lock_waits; /* ...that found it held. */
+    long long frame_lock_ticks;         /* Time spent waiting. */
+
+    /* Fault latency.  Bucket 0 counts faults served in the tick
+       they started, bucket I > 0 those that took [2**(I-1), 2**I)
+       ticks; the last bucket has everything longer. */
+    unsigned long long minflt_ticks[VMSTAT_BUCKETS];
+    unsigned long long majflt_ticks[VMSTAT_BUCKETS];
+  };
+
+/* One buffer of a readv() or writev(). */
+struct iovec
+  {
+    void *iov_base;             /* Start of the buffer. */
+    size_t iov_len;             /* Its size in bytes. */
+  };
+
+/* Most buffers one readv() or writev() accepts. */
+#define IOV_MAX 32
+
+/* Asynchronous I/O ring, registered with aio_setup().  The
+   program fills in sq[sq_tail % AIO_RING_ENTRIES] and advances
+   sq_tail; aio_enter() hands entries to the kernel, advancing
+   sq_head.  The kernel writes a completion to
+   cq[cq_tail % AIO_RING_ENTRIES] and advances cq_tail as each
+   request finishes, and the program reads it and advances
+   cq_head.  Requests finish in the order submitted, except that
+   bad ones finish at once with -1. */
+#define AIO_RING_ENTRIES 64
+
+/* Submission opcodes. */
+#define AIO_READ 0              /* Read LEN bytes at OFFSET into BUF. */
+#define AIO_WRITE 1             /* Write LEN bytes from BUF at OFFSET. */
+#define AIO_FSYNC 2             /* Complete after all earlier requests. */
+
+struct aio_sqe
+  {
+    int opcode;                 /* AIO_READ, AIO_WRITE or AIO_FSYNC. */
+    int fd;
+    void *buf;
+    unsigned len;               /* At most 64 kB is transferred. */
+    unsigned offset;            /* File offset; the position is unused. */
+    unsigned user_data;         /* Copied to the completion. */
+  };
+
+struct aio_cqe
+  {
+    unsigned user_data;
+    int result;                 /* Bytes transferred, or -1. */
+  };
+
+/* Fits in the single page it must occupy. */
+struct aio_ring
+  {
+    volatile unsigned sq_head, sq_tail;
+    volatile unsigned cq_head, cq_tail;
+    struct aio_sqe sq[AIO_RING_ENTRIES];
+    struct aio_cqe cq[AIO_RING_ENTRIES];
+  };
+
+/* Extensions. */
+pid_t fork (void);
+unsigned rss_limit (unsigned pages);
+mapid_t mmap_populate (int fd, void *addr);
+bool msync (mapid_t, size_t offset, size_t length);
+bool madvise (void *addr, size_t length, int advice);
+void vmstat (struct vmstat *);
+int readv (int fd, const struct iovec *, int iovcnt);
+int writev (int fd, const struct iovec *, int iovcnt);
+int pread (int fd, void *, unsigned size, unsigned offset);
+int pwrite (int fd, const void *, unsigned size, unsigned offset);
+bool aio_setup (struct aio_ring *);
+int aio_enter (unsigned to_submit, unsigned min_complete);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,73 @@
+/* Writes two pages of a file through the asynchronous I/O ring
+   with an fsync behind them, then reads them back in one batch
+   along with a request for a bad fd, checking each completion. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct aio_ring ring __attribute__ ((aligned (4096)));
+static char out[2][4096], in[2][4096];
+
+/* Adds a request to the submission queue, tagged with its
+   position in the queue. */
+static void
+push (int opcode, int fd, void *buf, unsigned len, unsigned offset)
+{
+  struct aio_sqe *sqe = &ring.sq[ring.sq_tail % AIO_RING_ENTRIES];
+
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->buf = buf;
+  sqe->len = len;
+  sqe->offset = offset;
+  sqe->user_data = ring.sq_tail;
+  ring.sq_tail++;
+}
+
+/* Checks that the next completion is for request USER_DATA and
+   has RESULT. */
+static void
+reap (unsigned user_data, int result)
+{
+  struct aio_cqe *cqe = &ring.cq[ring.cq_head % AIO_RING_ENTRIES];
+
+  if (ring.cq_head == ring.cq_tail)
+    fail ("no completion for request %u", user_data);
+  if (cqe->user_data != user_data || cqe->result != result)
+    fail ("completion for request %u has result %d, expected request %u "
+          "with result %d", cqe->user_data, cqe->result, user_data, result);
+  ring.cq_head++;
+}
+
+void
+test_main (void) 
+{
+  int handle;
+
+  memset (out[0], 'a', sizeof out[0]);
+  memset (out[1], 'b', sizeof out[1]);
+  CHECK (create ("aio", sizeof out), "create \"aio\"");
+  CHECK ((handle = open ("aio")) > 1, "open \"aio\"");
+  CHECK (aio_setup (&ring), "aio_setup");
+
+  push (AIO_WRITE, handle, out[0], sizeof out[0], 0);
+  push (AIO_WRITE, handle, out[1], sizeof out[1], sizeof out[0]);
+  push (AIO_FSYNC, handle, NULL, 0, 0);
+  CHECK (aio_enter (3, 3) == 3, "submit two writes and an fsync");
+  reap (0, sizeof out[0]);
+  reap (1, sizeof out[1]);
+  reap (2, 0);
+
+  push (AIO_READ, 99, in[0], sizeof in[0], 0);
+  push (AIO_READ, handle, in[1], sizeof in[1], sizeof in[0]);
+  push (AIO_READ, handle, in[0], sizeof in[0], 0);
+  CHECK (aio_enter (3, 3) == 3, "submit three reads");
+  reap (3, -1);
+  reap (4, sizeof in[1]);
+  reap (5, sizeof in[0]);
+  if (memcmp (in, out, sizeof in))
+    fail ("read back wrong data");
+  close (handle);
+}
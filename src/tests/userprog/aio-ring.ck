@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(aio-ring) begin
+(aio-ring) create "aio"
+(aio-ring) open "aio"
+(aio-ring) aio_setup
+(aio-ring) submit two writes and an fsync
+(aio-ring) submit three reads
+(aio-ring) end
+aio-ring: exit(0)
+EOF
+pass;
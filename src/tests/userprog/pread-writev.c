@@ -0,0 +1,35 @@
+/* Writes a file from three buffers with writev(), reads and
+   rewrites part of it with pread() and pwrite(), and reads it all
+   back into two buffers with readv(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static char hello[] = "Hello, ", vectored[] = "vectored ", world[] = "world!";
+  struct iovec out[3] = {{hello, 7}, {vectored, 9}, {world, 6}};
+  char first[8], second[14], buf[8];
+  struct iovec in[2] = {{first, sizeof first}, {second, sizeof second}};
+  int handle;
+
+  CHECK (create ("iov", 22), "create \"iov\"");
+  CHECK ((handle = open ("iov")) > 1, "open \"iov\"");
+  CHECK (writev (handle, out, 3) == 22, "writev 22 bytes");
+  CHECK (tell (handle) == 22, "tell after writev");
+
+  CHECK (pread (handle, buf, 8, 7) == 8, "pread 8 bytes at 7");
+  if (memcmp (buf, "vectored", 8))
+    fail ("pread read wrong data");
+  CHECK (tell (handle) == 22, "tell after pread");
+  CHECK (pwrite (handle, "VECTORED", 8, 7) == 8, "pwrite 8 bytes at 7");
+
+  seek (handle, 0);
+  CHECK (readv (handle, in, 2) == 22, "readv 22 bytes");
+  if (memcmp (first, "Hello, V", 8) || memcmp (second, "ECTORED world!", 14))
+    fail ("readv read wrong data");
+  close (handle);
+}
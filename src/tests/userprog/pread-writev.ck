@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-writev) begin
+(pread-writev) create "iov"
+(pread-writev) open "iov"
+(pread-writev) writev 22 bytes
+(pread-writev) tell after writev
+(pread-writev) pread 8 bytes at 7
+(pread-writev) tell after pread
+(pread-writev) pwrite 8 bytes at 7
+(pread-writev) readv 22 bytes
+(pread-writev) end
+pread-writev: exit(0)
+EOF
+pass;
@@ -0,0 +1,49 @@
+/* Forks a process with a large initialized buffer and has the
+   child overwrite its copy.  Neither process may see the other's
+   data afterward. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (64 * 1024)
+
+static char buf[SIZE];
+
+static bool
+filled_with (char c)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != c)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+  int status;
+
+  memset (buf, 'p', SIZE);
+  CHECK ((child = fork ()) != PID_ERROR, "fork");
+  if (child == 0)
+    {
+      if (!filled_with ('p'))
+        fail ("child does not see parent's data");
+      memset (buf, 'c', SIZE);
+      if (!filled_with ('c'))
+        fail ("child's writes were lost");
+      msg ("child overwrote its copy");
+      exit (81);
+    }
+
+  status = wait (child);
+  CHECK (status == 81, "wait for child");
+  if (!filled_with ('p'))
+    fail ("parent sees child's writes");
+  msg ("parent's copy intact");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fork-cow) begin
+(fork-cow) fork
+(fork-cow) child overwrote its copy
+(fork-cow) wait for child
+(fork-cow) parent's copy intact
+(fork-cow) end
+EOF
+pass;
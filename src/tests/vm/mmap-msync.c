@@ -0,0 +1,37 @@
+/* Modifies a mapped file, writes it back with msync(), and reads
+   the file to check the change reached it.  Then drops the pages
+   with madvise() and checks that the mapping still shows the
+   change. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static const char overwrite[] = "Hello, msync!";
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  char buf[sizeof sample];
+  int handle;
+  mapid_t map;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (handle, actual)) != MAP_FAILED, "mmap \"sample.txt\"");
+  memcpy (actual + 100, overwrite, strlen (overwrite));
+  CHECK (msync (map, 0, 0), "msync \"sample.txt\"");
+
+  memcpy (buf, sample, strlen (sample));
+  memcpy (buf + 100, overwrite, strlen (overwrite));
+  check_file_handle (handle, "sample.txt", buf, strlen (sample));
+
+  CHECK (madvise (actual, 4096, MADV_DONTNEED), "madvise DONTNEED");
+  if (memcmp (actual, buf, strlen (sample)))
+    fail ("mapping lost data written back by msync");
+
+  munmap (map);
+  close (handle);
+}
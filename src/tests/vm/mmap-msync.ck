@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-msync) begin
+(mmap-msync) open "sample.txt"
+(mmap-msync) mmap "sample.txt"
+(mmap-msync) msync "sample.txt"
+(mmap-msync) madvise DONTNEED
+(mmap-msync) end
+EOF
+pass;
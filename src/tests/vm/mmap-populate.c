@@ -0,0 +1,39 @@
+/* Writes a file several pages long, maps it with mmap_populate(),
+   and checks that the mapping holds the file's data followed by
+   zeros. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (20 * 4096 + 100)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  int handle;
+  mapid_t map;
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    buf[i] = i % 251;
+  CHECK (create ("data", SIZE), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+  CHECK (write (handle, buf, SIZE) == SIZE, "write \"data\"");
+  CHECK ((map = mmap_populate (handle, actual)) != MAP_FAILED,
+         "mmap_populate \"data\"");
+
+  if (memcmp (actual, buf, SIZE))
+    fail ("read of populated mapping reported bad data");
+  for (i = SIZE; i < 21 * 4096; i++)
+    if (actual[i] != 0)
+      fail ("byte %zu of mapping has value %02hhx (should be 0)",
+            i, actual[i]);
+
+  munmap (map);
+  close (handle);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-populate) begin
+(mmap-populate) create "data"
+(mmap-populate) open "data"
+(mmap-populate) write "data"
+(mmap-populate) mmap_populate "data"
+(mmap-populate) end
+EOF
+pass;
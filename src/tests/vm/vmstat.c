@@ -0,0 +1,40 @@
+/* Touches fresh pages and checks that vmstat() counts the faults
+   against this process and in the latency histograms. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (16 * 4096)
+
+static char buf[SIZE];
+
+static unsigned long long
+hist_sum (const unsigned long long *hist)
+{
+  unsigned long long sum = 0;
+  int i;
+
+  for (i = 0; i < VMSTAT_BUCKETS; i++)
+    sum += hist[i];
+  return sum;
+}
+
+void
+test_main (void)
+{
+  struct vmstat before, after;
+
+  vmstat (&before);
+  memset (buf, 0x5a, SIZE);
+  vmstat (&after);
+
+  CHECK (after.minflt + after.majflt > before.minflt + before.majflt,
+         "faults counted for this process");
+  CHECK (after.all_minflt >= after.minflt
+         && after.all_majflt >= after.majflt, "totals include this process");
+  CHECK (hist_sum (after.minflt_ticks) == after.all_minflt
+         && hist_sum (after.majflt_ticks) == after.all_majflt,
+         "every fault is in a latency bucket");
+}
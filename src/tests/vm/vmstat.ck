@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(vmstat) begin
+(vmstat) faults counted for this process
+(vmstat) totals include this process
+(vmstat) every fault is in a latency bucket
+(vmstat) end
+EOF
+pass;
@@ -23,12 +23,18 @@
 #include "threads/pte.h"
 #include "threads/thread.h"
 #include "vm/swap.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/zswap.h"
+#endif
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
+#include "userprog/aio.h"
 #else
 #include "tests/threads/tests.h"
 #endif
@@ -58,6 +64,32 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+#ifdef VM
+/* -lw: Number of free user pages the pageout daemon maintains. */
+static size_t pageout_low_water;
+
+/* -rss: Default limit on each process's resident pages. */
+static size_t rss_limit_pages;
+
+/* -vmpolicy: Page replacement policy. */
+static const char *vm_policy;
+
+/* -stack: Largest stack of each process, in pages. */
+static size_t stack_limit_pages;
+
+/* -stkgrow: Pages the stack grows by at a time. */
+static size_t stack_grow_pages;
+
+/* -zswap: Kernel pages for compressed swap. */
+static size_t zswap_pages;
+
+/* -ksm: Frames scanned for same-page merging per pass, 0 for none. */
+static size_t ksm_pages;
+#endif
+
+/* Page Size Extensions bit in CR4: enables 4 MB pages. */
+#define CR4_PSE 0x00000010
+
 static void bss_init (void);
 static void paging_init (void);
 
@@ -99,6 +131,11 @@ main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+#ifdef VM
+  frame_init (pageout_low_water, rss_limit_pages, vm_policy);
+  stable_boot_init (stack_limit_pages, stack_grow_pages);
+  zswap_init (zswap_pages);
+#endif
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -129,6 +166,13 @@ main (void)
 #endif
 
   swap_init();
+#ifdef VM
+  frame_pageout_init ();
+  frame_ksm_init (ksm_pages);
+#endif
+#ifdef USERPROG
+  aio_init ();
+#endif
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -188,6 +232,13 @@ paging_init (void)
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base Address
      of the Page Directory". */
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)));
+
+#ifdef VM
+  /* Allow 4 MB pages, which the VM code uses for large user
+     regions.  See [IA32-v3a] 2.5 "Control Registers". */
+  asm volatile ("movl %%cr4, %%eax; orl %0, %%eax; movl %%eax, %%cr4"
+                : : "i" (CR4_PSE) : "eax");
+#endif
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -261,6 +312,22 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-lw"))
+        pageout_low_water = atoi (value);
+      else if (!strcmp (name, "-rss"))
+        rss_limit_pages = atoi (value);
+      else if (!strcmp (name, "-vmpolicy"))
+        vm_policy = value;
+      else if (!strcmp (name, "-stack"))
+        stack_limit_pages = atoi (value);
+      else if (!strcmp (name, "-stkgrow"))
+        stack_grow_pages = atoi (value);
+      else if (!strcmp (name, "-zswap"))
+        zswap_pages = atoi (value);
+      else if (!strcmp (name, "-ksm"))
+        ksm_pages = atoi (value);
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -383,6 +450,15 @@ usage (void)
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+          "  -lw=COUNT          Keep COUNT user pages free for page faults.\n"
+          "  -rss=COUNT         Limit each process to COUNT resident pages.\n"
+          "  -vmpolicy=POLICY   Replace pages with clock (default), wsclock or 2q.\n"
+          "  -stack=COUNT       Limit each process's stack to COUNT pages.\n"
+          "  -stkgrow=COUNT     Grow stacks COUNT pages at a time.\n"
+          "  -zswap=COUNT       Keep up to COUNT pages of compressed swap in RAM.\n"
+          "  -ksm=COUNT         Scan COUNT frames for identical pages every 100 ms.\n"
 #endif
           );
   shutdown_power_off ();
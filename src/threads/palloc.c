@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -33,6 +34,7 @@ struct pool
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+    size_t free_cnt;                    /* Number of free pages. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -41,6 +43,8 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static void *claimed_pages (struct pool *, enum palloc_flags,
+                            size_t page_idx, size_t page_cnt);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -73,33 +77,55 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-  void *pages;
   size_t page_idx;
+  enum intr_level old_level;
 
   if (page_cnt == 0)
     return NULL;
 
   lock_acquire (&pool->lock);
   page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
-
   if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
-  else
-    pages = NULL;
-
-  if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
-        memset (pages, 0, PGSIZE * page_cnt);
-    }
-  else 
-    {
-      if (flags & PAL_ASSERT)
-        PANIC ("palloc_get: out of pages");
+      old_level = intr_disable ();
+      pool->free_cnt -= page_cnt;
+      intr_set_level (old_level);
     }
+  lock_release (&pool->lock);
 
-  return pages;
+  return claimed_pages (pool, flags, page_idx, page_cnt);
+}
+
+/* Like palloc_get_multiple(), but the physical address of the
+   first page is a multiple of ALIGN_CNT pages. */
+void *
+palloc_get_aligned (enum palloc_flags flags, size_t page_cnt, size_t align_cnt)
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  uintptr_t base = vtop (pool->base);
+  size_t page_idx = BITMAP_ERROR;
+  size_t pool_cnt = bitmap_size (pool->used_map);
+  size_t i;
+  enum intr_level old_level;
+
+  if (page_cnt == 0 || align_cnt == 0)
+    return NULL;
+
+  lock_acquire (&pool->lock);
+  for (i = (ROUND_UP (base, align_cnt * PGSIZE) - base) / PGSIZE;
+       i + page_cnt <= pool_cnt; i += align_cnt)
+    if (bitmap_none (pool->used_map, i, page_cnt))
+      {
+        bitmap_set_multiple (pool->used_map, i, page_cnt, true);
+        page_idx = i;
+        old_level = intr_disable ();
+        pool->free_cnt -= page_cnt;
+        intr_set_level (old_level);
+        break;
+      }
+  lock_release (&pool->lock);
+
+  return claimed_pages (pool, flags, page_idx, page_cnt);
 }
 
 /* Obtains a single free page and returns its kernel virtual
@@ -121,6 +147,7 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 {
   struct pool *pool;
   size_t page_idx;
+  enum intr_level old_level;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
@@ -143,6 +170,12 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+
+  /* Frees are not serialized by the pool lock, so keep the
+     counter update atomic. */
+  old_level = intr_disable ();
+  pool->free_cnt += page_cnt;
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -152,6 +185,30 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Returns the kernel virtual address of the first page in the
+   user pool.  Pages handed out with PAL_USER are numbered from
+   here, which lets callers keep per-frame tables as arrays. */
+void *
+palloc_user_base (void)
+{
+  return user_pool.base;
+}
+
+/* Returns the number of pages in the user pool. */
+size_t
+palloc_user_page_cnt (void)
+{
+  return bitmap_size (user_pool.used_map);
+}
+
+/* Returns the number of user pool pages that are currently
+   free.  The value may be stale by the time the caller uses it. */
+size_t
+palloc_user_free_cnt (void)
+{
+  return user_pool.free_cnt;
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
@@ -171,6 +228,7 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   lock_init (&p->lock);
   p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
   p->base = base + bm_pages * PGSIZE;
+  p->free_cnt = page_cnt;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -184,3 +242,32 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the PAGE_CNT pages at PAGE_IDX in POOL, which the caller
+   has just marked used, zeroed if PAL_ZERO is set in FLAGS.  If
+   PAGE_IDX is BITMAP_ERROR, returns a null pointer, or panics if
+   PAL_ASSERT is set in FLAGS. */
+static void *
+claimed_pages (struct pool *pool, enum palloc_flags flags,
+               size_t page_idx, size_t page_cnt)
+{
+  void *pages;
+
+  if (page_idx != BITMAP_ERROR)
+    pages = pool->base + PGSIZE * page_idx;
+  else
+    pages = NULL;
+
+  if (pages != NULL) 
+    {
+      if (flags & PAL_ZERO)
+        memset (pages, 0, PGSIZE * page_cnt);
+    }
+  else 
+    {
+      if (flags & PAL_ASSERT)
+        PANIC ("palloc_get: out of pages");
+    }
+
+  return pages;
+}
@@ -14,7 +14,12 @@ enum palloc_flags
 void palloc_init (size_t user_page_limit);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
+void *palloc_get_aligned (enum palloc_flags, size_t page_cnt,
+                          size_t align_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+void *palloc_user_base (void);
+size_t palloc_user_page_cnt (void);
+size_t palloc_user_free_cnt (void);
 
 #endif /* threads/palloc.h */
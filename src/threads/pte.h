@@ -66,6 +66,12 @@ static inline uintptr_t pd_no (const void *va) {
 #define PTE_U 0x4               /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20              /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40              /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80             /* 1=4 MB page, 0=page table (PDEs only). */
+
+/* A page directory entry with PTE_PS set maps a whole 4 MB large
+   page, which must be 4 MB aligned physically and virtually. */
+#define LARGE_PAGE_SIZE (1 << PDSHIFT)     /* Bytes in a large page. */
+#define LARGE_PAGE_CNT  (1 << PTBITS)      /* Pages in a large page. */
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create (uint32_t *pt) {
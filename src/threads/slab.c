@@ -0,0 +1,171 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Each slab is one page from the kernel pool, starting with a
+   struct slab and followed by OBJS_PER_SLAB objects.  Free
+   objects of a slab form a singly linked list through their
+   first word.  A slab that has free objects is on its cache's
+   PARTIAL list; a full slab is on no list.  A slab whose objects
+   are all free goes back to the page allocator, unless the cache
+   would then have no free objects left. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Slab header. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct slab_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in cache's PARTIAL list. */
+    size_t free_cnt;            /* Number of free objects. */
+    void *free;                 /* First free object. */
+  };
+
+/* Offset of the first object in a slab. */
+#define SLAB_HEADER ROUND_UP (sizeof (struct slab), sizeof (void *))
+
+/* All caches, for statistics. */
+static struct list caches = LIST_INITIALIZER (caches);
+
+static struct slab *slab_create (struct slab_cache *);
+
+/* Initializes CACHE to hand out objects of SIZE bytes.  NAME
+   identifies it in statistics and must stay valid. */
+void
+slab_cache_init (struct slab_cache *cache, const char *name, size_t size)
+{
+  ASSERT (size > 0);
+
+  cache->name = name;
+  cache->obj_size = ROUND_UP (size, sizeof (void *));
+  cache->objs_per_slab = (PGSIZE - SLAB_HEADER) / cache->obj_size;
+  ASSERT (cache->objs_per_slab > 0);
+  list_init (&cache->partial);
+  lock_init (&cache->lock);
+  cache->slab_cnt = 0;
+  cache->in_use = 0;
+  cache->peak = 0;
+  cache->alloc_cnt = 0;
+  cache->fail_cnt = 0;
+  list_push_back (&caches, &cache->elem);
+}
+
+/* Obtains and returns a new object from CACHE, or a null pointer
+   if memory is not available.  The object is not initialized. */
+void *
+slab_alloc (struct slab_cache *cache)
+{
+  struct slab *s;
+  void *obj;
+
+  lock_acquire (&cache->lock);
+  if (list_empty (&cache->partial))
+    {
+      s = slab_create (cache);
+      if (s == NULL)
+        {
+          cache->fail_cnt++;
+          lock_release (&cache->lock);
+          return NULL;
+        }
+      list_push_front (&cache->partial, &s->elem);
+    }
+  else
+    s = list_entry (list_front (&cache->partial), struct slab, elem);
+
+  obj = s->free;
+  s->free = *(void **) obj;
+  if (--s->free_cnt == 0)
+    list_remove (&s->elem);
+
+  cache->alloc_cnt++;
+  if (++cache->in_use > cache->peak)
+    cache->peak = cache->in_use;
+  lock_release (&cache->lock);
+  return obj;
+}
+
+/* Returns OBJ, obtained from CACHE, to CACHE.  A null OBJ is
+   ignored. */
+void
+slab_free (struct slab_cache *cache, void *obj)
+{
+  struct slab *s;
+
+  if (obj == NULL)
+    return;
+
+  s = pg_round_down (obj);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == cache);
+
+  lock_acquire (&cache->lock);
+  *(void **) obj = s->free;
+  s->free = obj;
+  if (s->free_cnt++ == 0)
+    list_push_front (&cache->partial, &s->elem);
+  cache->in_use--;
+
+  /* Give an empty slab back if other slabs can take the next
+     allocation. */
+  if (s->free_cnt == cache->objs_per_slab
+      && cache->slab_cnt * cache->objs_per_slab - cache->in_use
+         > cache->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      cache->slab_cnt--;
+      s->magic = 0;
+      palloc_free_page (s);
+    }
+  lock_release (&cache->lock);
+}
+
+/* Prints statistics for every cache. */
+void
+slab_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e))
+    {
+      struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+      printf ("Slab %s: %zu objects of %zu bytes in use, %zu peak, "
+              "%zu slabs, %llu allocations, %llu failed\n",
+              c->name, c->in_use, c->obj_size, c->peak, c->slab_cnt,
+              c->alloc_cnt, c->fail_cnt);
+    }
+}
+
+/* Allocates a slab for CACHE with all its objects free.  Returns
+   a null pointer if no page is available.  CACHE's lock must be
+   held. */
+static struct slab *
+slab_create (struct slab_cache *cache)
+{
+  struct slab *s;
+  uint8_t *obj;
+  size_t i;
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = cache;
+  s->free_cnt = cache->objs_per_slab;
+  s->free = NULL;
+  obj = (uint8_t *) s + SLAB_HEADER;
+  for (i = 0; i < cache->objs_per_slab; i++)
+    {
+      void *o = obj + (cache->objs_per_slab - 1 - i) * cache->obj_size;
+      *(void **) o = s->free;
+      s->free = o;
+    }
+  cache->slab_cnt++;
+  return s;
+}
@@ -0,0 +1,35 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* An object cache: allocates objects of one fixed size out of
+   whole pages ("slabs") kept for that cache alone.  Cheaper than
+   malloc() for small objects allocated and freed often, and
+   wastes less memory when the size is not a power of 2. */
+struct slab_cache
+  {
+    const char *name;           /* Name for statistics. */
+    size_t obj_size;            /* Object size, rounded up. */
+    size_t objs_per_slab;       /* Objects in one slab. */
+    struct list partial;        /* Slabs with free objects. */
+    struct lock lock;           /* Protects the fields below. */
+    struct list_elem elem;      /* Element in list of all caches. */
+
+    /* Statistics. */
+    size_t slab_cnt;            /* Pages held. */
+    size_t in_use;              /* Objects allocated now. */
+    size_t peak;                /* Most objects allocated at once. */
+    unsigned long long alloc_cnt;       /* Successful allocations. */
+    unsigned long long fail_cnt;        /* Allocations that failed. */
+  };
+
+void slab_cache_init (struct slab_cache *, const char *name, size_t size);
+void *slab_alloc (struct slab_cache *);
+void slab_free (struct slab_cache *, void *);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
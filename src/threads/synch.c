@@ -336,3 +336,104 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes RWLOCK, held by nobody. */
+void
+rwlock_init (struct rwlock *rwlock)
+{
+  ASSERT (rwlock != NULL);
+
+  lock_init (&rwlock->lock);
+  cond_init (&rwlock->can_read);
+  cond_init (&rwlock->can_write);
+  rwlock->readers = 0;
+  rwlock->waiting_writers = 0;
+  rwlock->writer = NULL;
+  rwlock->depth = 0;
+}
+
+/* Acquires RWLOCK for reading, sleeping while a writer holds it
+   or waits for it. */
+void
+rwlock_acquire_read (struct rwlock *rwlock)
+{
+  ASSERT (rwlock != NULL);
+  ASSERT (!intr_context ());
+
+  if (rwlock->writer == thread_current ())
+    {
+      rwlock->depth++;
+      return;
+    }
+  lock_acquire (&rwlock->lock);
+  while (rwlock->writer != NULL || rwlock->waiting_writers > 0)
+    cond_wait (&rwlock->can_read, &rwlock->lock);
+  rwlock->readers++;
+  lock_release (&rwlock->lock);
+}
+
+/* Releases RWLOCK, held for reading by the current thread. */
+void
+rwlock_release_read (struct rwlock *rwlock)
+{
+  ASSERT (rwlock != NULL);
+
+  if (rwlock->writer == thread_current ())
+    {
+      ASSERT (rwlock->depth > 0);
+      rwlock->depth--;
+      return;
+    }
+  lock_acquire (&rwlock->lock);
+  ASSERT (rwlock->readers > 0);
+  if (--rwlock->readers == 0)
+    cond_signal (&rwlock->can_write, &rwlock->lock);
+  lock_release (&rwlock->lock);
+}
+
+/* Acquires RWLOCK for writing, sleeping until no other thread
+   holds it. */
+void
+rwlock_acquire_write (struct rwlock *rwlock)
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (rwlock != NULL);
+  ASSERT (!intr_context ());
+
+  if (rwlock->writer == cur)
+    {
+      rwlock->depth++;
+      return;
+    }
+  lock_acquire (&rwlock->lock);
+  rwlock->waiting_writers++;
+  while (rwlock->writer != NULL || rwlock->readers > 0)
+    cond_wait (&rwlock->can_write, &rwlock->lock);
+  rwlock->waiting_writers--;
+  rwlock->writer = cur;
+  lock_release (&rwlock->lock);
+}
+
+/* Releases RWLOCK, held for writing by the current thread.  Hands
+   it to the next writer if one waits, otherwise to all waiting
+   readers. */
+void
+rwlock_release_write (struct rwlock *rwlock)
+{
+  ASSERT (rwlock != NULL);
+  ASSERT (rwlock->writer == thread_current ());
+
+  if (rwlock->depth > 0)
+    {
+      rwlock->depth--;
+      return;
+    }
+  lock_acquire (&rwlock->lock);
+  rwlock->writer = NULL;
+  if (rwlock->waiting_writers > 0)
+    cond_signal (&rwlock->can_write, &rwlock->lock);
+  else
+    cond_broadcast (&rwlock->can_read, &rwlock->lock);
+  lock_release (&rwlock->lock);
+}
@@ -41,6 +41,27 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock.  Held by any number of readers or by one
+   writer.  A waiting writer keeps new readers out, so a stream of
+   readers cannot starve it.  The writer may acquire the lock again,
+   for reading or writing, while it holds it. */
+struct rwlock
+  {
+    struct lock lock;           /* Protects the members below. */
+    struct condition can_read;  /* Signaled when readers may enter. */
+    struct condition can_write; /* Signaled when a writer may enter. */
+    int readers;                /* Number of readers holding it. */
+    int waiting_writers;        /* Number of writers waiting. */
+    struct thread *writer;      /* Writer holding it, or NULL. */
+    int depth;                  /* Writer's nested acquires. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -12,6 +12,7 @@
 #include "threads/vaddr.h"
 #ifdef USERPROG
 #include "userprog/process.h"
+#include "userprog/aio.h"
 #endif
 #ifdef VM
 #include "vm/frame.h"
@@ -97,7 +98,6 @@ void thread_init(void)
   list_init(&ready_list);
   list_init(&all_list);
   list_init (&sleep_list);
-  frame_init();
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread();
   init_thread(initial_thread, "main", PRI_DEFAULT);
@@ -304,6 +304,9 @@ void thread_exit(void)
   sema_down(&cur->sema_exit_scheduler);
   sema_up(&cur->sema_scheduler);
   list_remove(&cur->childelem);
+#ifdef USERPROG
+  aio_exit();
+#endif
 #ifdef VM
   stable_exit(&cur->stable);
 #endif
@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include <hash.h>
 #include "threads/synch.h"
+#include "vm/vma.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -103,10 +104,19 @@ struct thread
   struct semaphore sema_exit_scheduler;
   struct semaphore sema_load;
   struct file* fd[131];
-  struct hash stable;
+  struct vma_tree stable;  /* Virtual memory areas. */
+  void *fault_next;        /* Page a sequential file fault would hit next. */
+  size_t fault_window;     /* Current fault-around window, in pages. */
+  size_t rss;              /* Resident user pages, under frame_lock. */
+  size_t rss_limit;        /* Resident page cap, 0 for the default. */
+  size_t rss_hand;         /* Clock hand over this process's frames. */
+  unsigned long long minflt;  /* Page faults served without I/O. */
+  unsigned long long majflt;  /* Page faults that read from disk. */
+  bool fault_major;        /* Current fault has read from disk. */
 #ifdef USERPROG
   /* Owned by userprog/process.c. */
   uint32_t *pagedir; /* Page directory. */
+  struct aio_ctx *aio; /* Asynchronous I/O ring, or NULL. */
 #endif
 
   /* Owned by thread.c. */
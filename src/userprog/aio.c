@@ -0,0 +1,352 @@
+#include "userprog/aio.h"
+#include <debug.h>
+#include <list.h>
+#include <stdint.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/vma.h"
+
+/* Asynchronous I/O.  A process registers one page of its own
+   memory as an aio_ring, which stays pinned so that the kernel
+   can reach it through its kernel address from any thread.
+   aio_enter() takes submission entries off the ring, pins each
+   request's buffer the same way, and queues it for a single
+   worker thread, which does the transfer and posts a completion
+   to the ring.  Requests from every process are served in order,
+   so a completion for AIO_FSYNC means every earlier request has
+   reached the disk: the buffer cache writes through. */
+
+/* Most pages one request's buffer can span. */
+#define AIO_PAGES (IO_CHUNK / PGSIZE + 1)
+
+/* A process's ring. */
+struct aio_ctx
+  {
+    struct aio_ring *ring;      /* User address of the ring. */
+    struct aio_ring *kring;     /* Kernel address of the same page. */
+    struct lock lock;           /* Guards INFLIGHT and posting to CQ. */
+    struct condition done;      /* Signalled when a request completes. */
+    unsigned inflight;          /* Submitted but not yet completed. */
+  };
+
+/* A request waiting for or being served by the worker. */
+struct aio_req
+  {
+    struct list_elem elem;      /* Element in aio_queue. */
+    struct aio_ctx *ctx;
+    struct aio_sqe sqe;         /* Copy of the submission entry. */
+    struct file *file;          /* Reopened, so close() cannot pull it away. */
+    size_t page_cnt;
+    uint8_t *kpages[AIO_PAGES];   /* Kernel address of each buffer page. */
+    struct frame_entry *frames[AIO_PAGES]; /* Pinned frames, NULL for zeros. */
+  };
+
+static struct list aio_queue;       /* Requests for the worker. */
+static struct lock aio_lock;        /* Guards aio_queue. */
+static struct condition aio_queued; /* Signalled when a request is queued. */
+
+static void aio_worker (void *aux);
+static void aio_submit (struct aio_ctx *, const struct aio_sqe *);
+static int aio_transfer (struct aio_req *);
+static void aio_post (struct aio_ctx *, unsigned user_data, int result);
+static void aio_wait (struct aio_ctx *, unsigned min_complete);
+
+/* Starts the worker thread. */
+void
+aio_init (void)
+{
+  list_init (&aio_queue);
+  lock_init (&aio_lock);
+  cond_init (&aio_queued);
+  thread_create ("aiod", PRI_DEFAULT, aio_worker, NULL);
+}
+
+/* Registers the page at RING as the current process's ring and
+   empties it.  The page must be in a writable area other than an
+   mmap, which could be unmapped from under the kernel.  Returns
+   false if it is not, or if the process already has a ring. */
+bool
+aio_setup (struct aio_ring *ring)
+{
+  struct thread *t = thread_current ();
+  struct aio_ctx *ctx;
+  struct vma *vma;
+
+  if (t->aio != NULL || pg_ofs (ring) != 0
+      || !user_range_ok (ring, sizeof *ring, true))
+    return false;
+  vma = vma_find (&t->stable, ring);
+  if (vma->mapid >= 0)
+    return false;
+
+  ctx = malloc (sizeof *ctx);
+  if (ctx == NULL)
+    return false;
+  if (!stable_pin (ring, sizeof *ring, true))
+    {
+      free (ctx);
+      return false;
+    }
+  ctx->ring = ring;
+  ctx->kring = pagedir_get_page (t->pagedir, ring);
+  lock_init (&ctx->lock);
+  cond_init (&ctx->done);
+  ctx->inflight = 0;
+  ctx->kring->sq_head = ctx->kring->sq_tail = 0;
+  ctx->kring->cq_head = ctx->kring->cq_tail = 0;
+  t->aio = ctx;
+  return true;
+}
+
+/* Submits up to TO_SUBMIT entries from the current process's
+   submission queue, stopping early if the completion queue could
+   not take their results.  Then waits until MIN_COMPLETE
+   completions are waiting to be read, or nothing is in flight.
+   Returns the number of entries submitted, or -1 if the process
+   has no ring. */
+int
+aio_enter (unsigned to_submit, unsigned min_complete)
+{
+  struct aio_ctx *ctx = thread_current ()->aio;
+  struct aio_ring *ring;
+  unsigned submitted = 0;
+
+  if (ctx == NULL)
+    return -1;
+  ring = ctx->kring;
+  while (submitted < to_submit && ring->sq_head != ring->sq_tail)
+    {
+      /* Copied first, since the process may change it under us. */
+      struct aio_sqe sqe = ring->sq[ring->sq_head % AIO_RING_ENTRIES];
+      bool room;
+
+      lock_acquire (&ctx->lock);
+      room = ctx->inflight + (ring->cq_tail - ring->cq_head) < AIO_RING_ENTRIES;
+      if (room)
+        ctx->inflight++;
+      lock_release (&ctx->lock);
+      if (!room)
+        break;
+
+      ring->sq_head++;
+      submitted++;
+      aio_submit (ctx, &sqe);
+    }
+  aio_wait (ctx, min_complete);
+  return submitted;
+}
+
+/* Waits until none of the current process's requests is in
+   flight, so that none of its pages but the ring is pinned. */
+void
+aio_drain (void)
+{
+  struct aio_ctx *ctx = thread_current ()->aio;
+
+  if (ctx == NULL)
+    return;
+  lock_acquire (&ctx->lock);
+  while (ctx->inflight > 0)
+    cond_wait (&ctx->done, &ctx->lock);
+  lock_release (&ctx->lock);
+}
+
+/* Pins the ring again after fork() has shared its page
+   copy-on-write, so that the process gets a page of its own and
+   the kernel writes completions to that one.  Drops the ring if
+   it cannot be pinned. */
+void
+aio_remap (void)
+{
+  struct thread *t = thread_current ();
+  struct aio_ctx *ctx = t->aio;
+
+  if (ctx == NULL)
+    return;
+  ASSERT (ctx->inflight == 0);
+  stable_unpin (ctx->ring, sizeof *ctx->ring);
+  if (stable_pin (ctx->ring, sizeof *ctx->ring, true))
+    ctx->kring = pagedir_get_page (t->pagedir, ctx->ring);
+  else
+    {
+      t->aio = NULL;
+      free (ctx);
+    }
+}
+
+/* Waits for the current process's requests to finish and releases
+   its ring.  Must run before its pages are freed. */
+void
+aio_exit (void)
+{
+  struct thread *t = thread_current ();
+  struct aio_ctx *ctx = t->aio;
+
+  if (ctx == NULL)
+    return;
+  aio_drain ();
+  stable_unpin (ctx->ring, sizeof *ctx->ring);
+  t->aio = NULL;
+  free (ctx);
+}
+
+/* Pins the buffer of SQE and queues it for the worker, or
+   completes it with -1 at once if it is bad.  A slot for it is
+   already counted in CTX's INFLIGHT. */
+static void
+aio_submit (struct aio_ctx *ctx, const struct aio_sqe *sqe)
+{
+  struct thread *t = thread_current ();
+  struct file *file = fd_file (sqe->fd);
+  bool is_read = sqe->opcode == AIO_READ;
+  struct aio_req *req;
+  uint8_t *buf, *upage;
+
+  if (file == NULL || (off_t) sqe->offset < 0
+      || (sqe->opcode != AIO_READ && sqe->opcode != AIO_WRITE
+          && sqe->opcode != AIO_FSYNC))
+    {
+      aio_post (ctx, sqe->user_data, -1);
+      return;
+    }
+  req = malloc (sizeof *req);
+  if (req == NULL)
+    {
+      aio_post (ctx, sqe->user_data, -1);
+      return;
+    }
+  req->ctx = ctx;
+  req->sqe = *sqe;
+  req->page_cnt = 0;
+  if (req->sqe.len > IO_CHUNK)
+    req->sqe.len = IO_CHUNK;
+  if (req->sqe.opcode == AIO_FSYNC)
+    req->sqe.len = 0;
+
+  req->file = file_reopen (file);
+  if (req->file == NULL)
+    goto fail;
+  buf = req->sqe.buf;
+  if (req->sqe.len > 0)
+    {
+      if (!user_range_ok (buf, req->sqe.len, is_read)
+          || !stable_pin (buf, req->sqe.len, is_read))
+        {
+          file_close (req->file);
+          goto fail;
+        }
+      for (upage = pg_round_down (buf); upage < buf + req->sqe.len;
+           upage += PGSIZE)
+        {
+          struct stable_entry *entry = stable_find_entry (t, upage);
+          /* The worker stores through the kernel address, which
+             leaves the user mapping's dirty bit alone. */
+          if (is_read)
+            pagedir_set_dirty (t->pagedir, upage, true);
+          req->kpages[req->page_cnt] = pagedir_get_page (t->pagedir, upage);
+          req->frames[req->page_cnt++] = entry->frame;
+        }
+    }
+
+  lock_acquire (&aio_lock);
+  list_push_back (&aio_queue, &req->elem);
+  cond_signal (&aio_queued, &aio_lock);
+  lock_release (&aio_lock);
+  return;
+
+ fail:
+  free (req);
+  aio_post (ctx, sqe->user_data, -1);
+}
+
+/* Serves queued requests forever. */
+static void
+aio_worker (void *aux UNUSED)
+{
+  for (;;)
+    {
+      struct aio_req *req;
+      int result;
+
+      lock_acquire (&aio_lock);
+      while (list_empty (&aio_queue))
+        cond_wait (&aio_queued, &aio_lock);
+      req = list_entry (list_pop_front (&aio_queue), struct aio_req, elem);
+      lock_release (&aio_lock);
+
+      result = aio_transfer (req);
+      for (size_t i = 0; i < req->page_cnt; i++)
+        if (req->frames[i] != NULL)
+          frame_unpin (req->frames[i]);
+      file_close (req->file);
+      aio_post (req->ctx, req->sqe.user_data, result);
+      free (req);
+    }
+}
+
+/* Does the transfer for REQ a page at a time through the kernel
+   addresses of its buffer.  Returns the number of bytes
+   transferred. */
+static int
+aio_transfer (struct aio_req *req)
+{
+  const struct aio_sqe *sqe = &req->sqe;
+  size_t ofs = pg_ofs (sqe->buf);
+  unsigned done = 0;
+
+  for (size_t i = 0; done < sqe->len; i++)
+    {
+      uint8_t *kaddr = req->kpages[i] + ofs;
+      off_t size = PGSIZE - ofs < sqe->len - done ? PGSIZE - ofs : sqe->len - done;
+      off_t n;
+
+      if (sqe->opcode == AIO_READ)
+        n = file_read_at (req->file, kaddr, size, sqe->offset + done);
+      else
+        n = file_write_at (req->file, kaddr, size, sqe->offset + done);
+      done += n;
+      if (n < size)
+        break;
+      ofs = 0;
+    }
+  return done;
+}
+
+/* Posts a completion of USER_DATA with RESULT to CTX's ring, and
+   retires one request in flight. */
+static void
+aio_post (struct aio_ctx *ctx, unsigned user_data, int result)
+{
+  struct aio_ring *ring;
+  struct aio_cqe *cqe;
+
+  lock_acquire (&ctx->lock);
+  ring = ctx->kring;
+  cqe = &ring->cq[ring->cq_tail % AIO_RING_ENTRIES];
+  cqe->user_data = user_data;
+  cqe->result = result;
+  barrier ();
+  ring->cq_tail++;
+  ctx->inflight--;
+  cond_broadcast (&ctx->done, &ctx->lock);
+  lock_release (&ctx->lock);
+}
+
+/* Waits until MIN_COMPLETE completions are waiting in CTX's ring,
+   or none of its requests is in flight. */
+static void
+aio_wait (struct aio_ctx *ctx, unsigned min_complete)
+{
+  lock_acquire (&ctx->lock);
+  while (ctx->inflight > 0
+         && ctx->kring->cq_tail - ctx->kring->cq_head < min_complete)
+    cond_wait (&ctx->done, &ctx->lock);
+  lock_release (&ctx->lock);
+}
@@ -0,0 +1,14 @@
+#ifndef USERPROG_AIO_H
+#define USERPROG_AIO_H
+
+#include <stdbool.h>
+#include "lib/user/syscall.h"
+
+void aio_init (void);
+bool aio_setup (struct aio_ring *);
+int aio_enter (unsigned to_submit, unsigned min_complete);
+void aio_drain (void);
+void aio_remap (void);
+void aio_exit (void);
+
+#endif /* userprog/aio.h */
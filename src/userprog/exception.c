@@ -8,6 +8,7 @@
 #include <debug.h>
 #ifdef VM
 #include "vm/page.h"
+#include "vm/vmstat.h"
 #endif
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -146,6 +147,9 @@ page_fault (struct intr_frame *f)
 
   /* Count page faults. */
   page_fault_cnt++;
+#ifdef VM
+  int64_t start = vmstat_fault_begin ();
+#endif
 
   /* Determine cause. */
   not_present = (f->error_code & PF_P) == 0;
@@ -160,18 +164,17 @@ page_fault (struct intr_frame *f)
     #ifdef VM
     // printf("not presetn ? fault addr %X \n", fault_addr);
 
-    struct stable_entry * sentry = stable_find_entry(thread_current(), fault_addr);
-    if(sentry){
-      if(stable_frame_alloc(fault_addr)){
+    if(stable_is_exist(thread_current(), fault_addr)){
+      if(stable_frame_alloc(fault_addr, write)){
         // printf("fault addr %X \n", fault_addr);
-        sentry->used = false;
+        vmstat_fault_end (start);
         return;
       }
-      sentry->used = false;
     }
     else{
       if(user && write && stable_stack_alloc(fault_addr)){
         // printf("stack alloc %d", fault_addr);
+        vmstat_fault_end (start);
         return;
       }
     }
@@ -183,6 +186,12 @@ page_fault (struct intr_frame *f)
      exit(-1);
   }
   if(!not_present  && write){
+    #ifdef VM
+    if(stable_cow_fault(fault_addr)){
+      vmstat_fault_end (start);
+      return;
+    }
+    #endif
     //  printf("trying to write existing code data %x\n", fault_addr);
      exit(-1);
   }
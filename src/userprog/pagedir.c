@@ -8,6 +8,7 @@
 
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
+static bool demote_large_page (uint32_t *pd, uint32_t *pde);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -34,7 +35,7 @@ pagedir_destroy (uint32_t *pd)
 
   ASSERT (pd != init_page_dir);
   for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
-    if (*pde & PTE_P) 
+    if ((*pde & (PTE_P | PTE_PS)) == PTE_P) 
       {
         uint32_t *pt = pde_get_pt (*pde);
         uint32_t *pte;
@@ -52,7 +53,12 @@ pagedir_destroy (uint32_t *pd)
    If PD does not have a page table for VADDR, behavior depends
    on CREATE.  If CREATE is true, then a new page table is
    created and a pointer into it is returned.  Otherwise, a null
-   pointer is returned. */
+   pointer is returned.
+   If VADDR lies in a large page, the page directory entry itself
+   is returned.  Its present, writable, accessed and dirty bits
+   are where a page table entry has them, so changing them
+   affects the whole 4 MB page.  Callers that need a single 4 kB
+   page split it with pagedir_demote() first. */
 static uint32_t *
 lookup_page (uint32_t *pd, const void *vaddr, bool create)
 {
@@ -79,6 +85,8 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
       else
         return NULL;
     }
+  else if ((*pde & PTE_PS) != 0)
+    return pde;
 
   /* Return the page table entry. */
   pt = pde_get_pt (*pde);
@@ -130,16 +138,19 @@ pagedir_get_page (uint32_t *pd, const void *uaddr)
   ASSERT (is_user_vaddr (uaddr));
   
   pte = lookup_page (pd, uaddr, false);
-  if (pte != NULL && (*pte & PTE_P) != 0)
-    return pte_get_page (*pte) + pg_ofs (uaddr);
-  else
+  if (pte == NULL || (*pte & PTE_P) == 0)
     return NULL;
+  else if (pagedir_is_large (pd, uaddr))
+    return ptov (*pte & PTE_ADDR) + ((uintptr_t) uaddr & (LARGE_PAGE_SIZE - 1));
+  else
+    return pte_get_page (*pte) + pg_ofs (uaddr);
 }
 
 /* Marks user virtual page UPAGE "not present" in page
    directory PD.  Later accesses to the page will fault.  Other
    bits in the page table entry are preserved.
-   UPAGE need not be mapped. */
+   UPAGE need not be mapped, but must not be part of a large
+   page; see pagedir_demote() and pagedir_unmap_large(). */
 void
 pagedir_clear_page (uint32_t *pd, void *upage) 
 {
@@ -147,6 +158,7 @@ pagedir_clear_page (uint32_t *pd, void *upage)
 
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (is_user_vaddr (upage));
+  ASSERT (!pagedir_is_large (pd, upage));
 
   pte = lookup_page (pd, upage, false);
   if (pte != NULL && (*pte & PTE_P) != 0)
@@ -214,6 +226,106 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
     }
 }
 
+/* Sets the writable bit to WRITABLE in the PTE for virtual page
+   VPAGE in PD.  Used to write-protect pages shared copy-on-write. */
+void
+pagedir_set_writable (uint32_t *pd, const void *vpage, bool writable) 
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  if (pte != NULL) 
+    {
+      if (writable)
+        *pte |= PTE_W;
+      else 
+        *pte &= ~(uint32_t) PTE_W;
+      invalidate_pagedir (pd);
+    }
+}
+
+/* Maps the LARGE_PAGE_SIZE bytes of user virtual memory starting
+   at UPAGE to the LARGE_PAGE_CNT contiguous frames starting at
+   kernel virtual address KPAGE, using one 4 MB page.  Both must be
+   4 MB aligned.  Returns false if part of the range already has a
+   page table or mapping. */
+bool
+pagedir_set_large_page (uint32_t *pd, void *upage, void *kpage, bool writable)
+{
+  uint32_t *pde;
+
+  ASSERT ((uintptr_t) upage % LARGE_PAGE_SIZE == 0);
+  ASSERT (vtop (kpage) % LARGE_PAGE_SIZE == 0);
+  ASSERT (is_user_vaddr (upage));
+  ASSERT (pd != init_page_dir);
+
+  pde = pd + pd_no (upage);
+  if (*pde != 0)
+    return false;
+  *pde = vtop (kpage) | PTE_PS | PTE_U | PTE_P | (writable ? PTE_W : 0);
+  return true;
+}
+
+/* Returns true if nothing in the 4 MB region of user virtual
+   memory containing VPAGE is mapped in PD yet, so that
+   pagedir_set_large_page() could map it. */
+bool
+pagedir_is_region_empty (uint32_t *pd, const void *vpage)
+{
+  return pd[pd_no (vpage)] == 0;
+}
+
+/* Returns true if VPAGE is mapped in PD by a 4 MB page. */
+bool
+pagedir_is_large (uint32_t *pd, const void *vpage)
+{
+  return (pd[pd_no (vpage)] & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS);
+}
+
+/* Splits the 4 MB page mapping VPAGE in PD, if any, into 4 kB
+   pages.  Returns false if out of memory, leaving the large page
+   as it was. */
+bool
+pagedir_demote (uint32_t *pd, const void *vpage)
+{
+  return !pagedir_is_large (pd, vpage)
+         || demote_large_page (pd, pd + pd_no (vpage));
+}
+
+/* Removes the 4 MB page mapping VPAGE in PD, if any, without
+   freeing its frames.  Lookups of its pages then find no
+   mapping.  Nothing is allocated, so unlike pagedir_demote() this
+   cannot fail. */
+void
+pagedir_unmap_large (uint32_t *pd, const void *vpage)
+{
+  if (pagedir_is_large (pd, vpage))
+    {
+      pd[pd_no (vpage)] = 0;
+      invalidate_pagedir (pd);
+    }
+}
+
+/* Replaces the 4 MB page that *PDE maps with a page table mapping
+   the same frames as 4 kB pages with the same permissions.  The
+   accessed and dirty bits are copied to every page, so each is
+   treated as used until it is looked at again.  Returns false if
+   no page table could be allocated. */
+static bool
+demote_large_page (uint32_t *pd, uint32_t *pde)
+{
+  uint32_t *pt = palloc_get_page (0);
+  uint32_t flags = *pde & PTE_FLAGS & ~(uint32_t) PTE_PS;
+  uint32_t paddr = *pde & PTE_ADDR;
+  size_t i;
+
+  if (pt == NULL)
+    return false;
+  for (i = 0; i < PGSIZE / sizeof *pt; i++)
+    pt[i] = (paddr + i * PGSIZE) | flags;
+  *pde = pde_create (pt);
+  invalidate_pagedir (pd);
+  return true;
+}
+
 /* Loads page directory PD into the CPU's page directory base
    register. */
 void
@@ -13,6 +13,12 @@ bool pagedir_is_dirty (uint32_t *pd, const void *upage);
 void pagedir_set_dirty (uint32_t *pd, const void *upage, bool dirty);
 bool pagedir_is_accessed (uint32_t *pd, const void *upage);
 void pagedir_set_accessed (uint32_t *pd, const void *upage, bool accessed);
+void pagedir_set_writable (uint32_t *pd, const void *upage, bool writable);
+bool pagedir_set_large_page (uint32_t *pd, void *upage, void *kpage, bool rw);
+bool pagedir_is_region_empty (uint32_t *pd, const void *upage);
+bool pagedir_is_large (uint32_t *pd, const void *upage);
+bool pagedir_demote (uint32_t *pd, const void *upage);
+void pagedir_unmap_large (uint32_t *pd, const void *upage);
 void pagedir_activate (uint32_t *pd);
 
 #endif /* userprog/pagedir.h */
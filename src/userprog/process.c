@@ -8,6 +8,7 @@
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
+#include "userprog/aio.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
@@ -21,6 +22,7 @@
 #include "vm/page.h"
 #endif
 static thread_func start_process NO_RETURN;
+static thread_func start_fork NO_RETURN;
 static bool load(const char *cmdline, void (**eip)(void), void **esp);
 
 char *
@@ -179,6 +181,89 @@ start_process(void *file_name_)
   NOT_REACHED();
 }
 
+/* What a forking process hands to its child. */
+struct fork_aux
+{
+  struct thread *parent;  /* Forking process, blocked until done. */
+  struct intr_frame if_;  /* Parent's user context at the syscall. */
+  bool success;           /* Set by the child once it is set up. */
+};
+
+/* Creates a child that is a copy of the current process, resuming
+   in user mode from F with fork() returning 0.  Memory is shared
+   copy-on-write and open files are duplicated.  Returns the
+   child's thread id, or TID_ERROR if it could not be set up. */
+tid_t process_fork(struct intr_frame *f)
+{
+  struct fork_aux aux;
+  tid_t tid;
+
+  aux.parent = thread_current();
+  aux.if_ = *f;
+  aux.success = false;
+  /* The child shares our pages, which must not be pinned for I/O
+     then; see aio_remap(). */
+  aio_drain();
+  tid = thread_create(thread_current()->name, PRI_DEFAULT, start_fork, &aux);
+  if (tid == TID_ERROR)
+    return TID_ERROR;
+
+  /* The child reads AUX and our page table, so wait for it. */
+  sema_down(&thread_get_child(tid)->sema_load);
+  aio_remap();
+  if (!aux.success)
+  {
+    process_wait(tid);
+    return TID_ERROR;
+  }
+  return tid;
+}
+
+/* A thread function that copies the forking process given in
+   AUX_ and starts running it in user mode. */
+static void
+start_fork(void *aux_)
+{
+  struct fork_aux *aux = aux_;
+  struct thread *cur = thread_current();
+  struct intr_frame if_ = aux->if_;
+  bool success = false;
+
+#ifdef VM
+  stable_init(&cur->stable);
+  cur->rss_limit = aux->parent->rss_limit;
+  cur->pagedir = pagedir_create();
+  if (cur->pagedir != NULL)
+  {
+    process_activate();
+    success = stable_fork(aux->parent);
+  }
+#endif
+  for (int i = 3; success && i < 131; i++)
+  {
+    if (aux->parent->fd[i] != NULL)
+    {
+      cur->fd[i] = file_duplicate(aux->parent->fd[i]);
+      success = cur->fd[i] != NULL;
+    }
+  }
+  aux->success = success;
+  sema_up(&cur->sema_load);
+
+  if (!success)
+  {
+    exit(-1);
+  }
+
+  /* Return from the system call as the child. */
+  if_.eax = 0;
+  asm volatile("movl %0, %%esp; jmp intr_exit"
+               :
+               : "g"(&if_)
+               : "memory");
+  NOT_REACHED();
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -495,25 +580,20 @@ load_segment(struct file *file, off_t ofs, uint8_t *upage,
   ASSERT((read_bytes + zero_bytes) % PGSIZE == 0);
   ASSERT(pg_ofs(upage) == 0);
   ASSERT(ofs % PGSIZE == 0);
-  off_t offset = ofs;
-  file_seek(file, ofs);
-  while (read_bytes > 0 || zero_bytes > 0)
-  {
-    /* Calculate how to fill this page.
-         We will read PAGE_READ_BYTES bytes from FILE
-         and zero the final PAGE_ZERO_BYTES bytes. */
-    size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-    size_t page_zero_bytes = PGSIZE - page_read_bytes;
-    stable_alloc(upage, file, offset ,page_read_bytes, writable, -1);
-    
-    offset += page_read_bytes;
-
-    /* Advance. */
-    read_bytes -= page_read_bytes;
-    zero_bytes -= page_zero_bytes;
-    upage += PGSIZE;
-  }
-  return true;
+  size_t page_cnt = (read_bytes + zero_bytes) / PGSIZE;
+
+  /* A page shared with the previous segment keeps that segment's
+     contents. */
+  while (page_cnt > 0 && stable_is_exist (thread_current (), upage))
+    {
+      size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
+      ofs += page_read_bytes;
+      read_bytes -= page_read_bytes;
+      upage += PGSIZE;
+      page_cnt--;
+    }
+  return page_cnt == 0
+         || stable_map (upage, page_cnt, file, ofs, read_bytes, writable, -1) != NULL;
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
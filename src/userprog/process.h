@@ -4,6 +4,8 @@
 #include "threads/thread.h"
 
 tid_t process_execute (const char *file_name);
+struct intr_frame;
+tid_t process_fork (struct intr_frame *);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
@@ -10,18 +10,23 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "userprog/process.h"
+#include "userprog/aio.h"
 #include "devices/input.h"
 #include "threads/malloc.h"
 #include "vm/frame.h"
 #include "vm/page.h"
+#include "vm/vmstat.h"
 #include <debug.h>
+#include <round.h>
+#include <string.h>
 
 static int mapid;
 static struct lock mapid_lock;
 
 static void syscall_handler(struct intr_frame *);
-void address_checking(int * p);
-void buffer_checking(void *buffer, unsigned size);
+static void check_user_range(const void *uaddr, size_t size, bool write);
+static void check_user_string(const char *ustr);
+static void check_user_iovec(const struct iovec *iov, unsigned iovcnt, bool write);
 void halt(void);
 void exit(int status);
 pid_t exec(const char* cmd_line);
@@ -39,122 +44,382 @@ void close(int fd);
 
 
 mapid_t mmap (int fd, void *addr);
+mapid_t mmap_populate (int fd, void *addr);
+static struct vma *mmap_file (int fd, void *addr, mapid_t *mapping);
+static int file_io (struct file *file, void *buffer, unsigned size, off_t offset, bool is_read);
 void munmap (mapid_t mapping);
+unsigned rss_limit (unsigned pages);
 
-void file_checking(const char * file);
 void thread_close(int status);
 
-static struct lock file_lock;
-void file_lock_acquire(void);
-void file_lock_release(void);
-
 void syscall_init(void)
 {
-  lock_init(&file_lock);
   lock_init(&mapid_lock);
   mapid = 0;
   intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
+/* Kinds of system call arguments.  The handler validates pointer
+   arguments against the caller's memory areas before dispatch, so
+   the system call itself may use them directly. */
+enum syscall_arg
+{
+  ARG_VALUE,      /* Passed through unchecked. */
+  ARG_STRING,     /* Null-terminated string read by the kernel. */
+  ARG_IN,         /* Buffer read by the kernel; size is the next argument. */
+  ARG_OUT,        /* Buffer written by the kernel; size is the next argument. */
+  ARG_OUT_FIXED,  /* Buffer of the descriptor's SIZE written by the kernel. */
+  ARG_IOV_IN,     /* Array of iovecs read from; count is the next argument. */
+  ARG_IOV_OUT     /* Array of iovecs written to; count is the next argument. */
+};
+
+typedef uint32_t syscall_func(const uint32_t *arg, struct intr_frame *f);
+
+/* Describes one system call. */
+struct syscall_desc
+{
+  syscall_func *func;
+  int argc;
+  enum syscall_arg args[4];
+  size_t size;    /* Size of an ARG_OUT_FIXED buffer. */
+};
+
+static syscall_func sys_halt, sys_exit, sys_exec, sys_wait, sys_create,
+  sys_remove, sys_open, sys_filesize, sys_read, sys_write, sys_seek,
+  sys_tell, sys_close, sys_mmap, sys_munmap, sys_rss_limit,
+  sys_mmap_populate, sys_msync, sys_madvise, sys_vmstat, sys_readv,
+  sys_writev, sys_pread, sys_pwrite, sys_aio_setup, sys_aio_enter;
+#ifdef VM
+static syscall_func sys_fork;
+#endif
+
+static const struct syscall_desc syscall_table[] =
+{
+  [SYS_HALT] = {sys_halt, 0, {0}, 0},
+  [SYS_EXIT] = {sys_exit, 1, {ARG_VALUE}, 0},
+  [SYS_EXEC] = {sys_exec, 1, {ARG_STRING}, 0},
+  [SYS_WAIT] = {sys_wait, 1, {ARG_VALUE}, 0},
+  [SYS_CREATE] = {sys_create, 2, {ARG_STRING, ARG_VALUE}, 0},
+  [SYS_REMOVE] = {sys_remove, 1, {ARG_STRING}, 0},
+  [SYS_OPEN] = {sys_open, 1, {ARG_STRING}, 0},
+  [SYS_FILESIZE] = {sys_filesize, 1, {ARG_VALUE}, 0},
+  [SYS_READ] = {sys_read, 3, {ARG_VALUE, ARG_OUT, ARG_VALUE}, 0},
+  [SYS_WRITE] = {sys_write, 3, {ARG_VALUE, ARG_IN, ARG_VALUE}, 0},
+  [SYS_SEEK] = {sys_seek, 2, {ARG_VALUE, ARG_VALUE}, 0},
+  [SYS_TELL] = {sys_tell, 1, {ARG_VALUE}, 0},
+  [SYS_CLOSE] = {sys_close, 1, {ARG_VALUE}, 0},
+  [SYS_MMAP] = {sys_mmap, 2, {ARG_VALUE, ARG_VALUE}, 0},
+  [SYS_MUNMAP] = {sys_munmap, 1, {ARG_VALUE}, 0},
+#ifdef VM
+  /* Children share frames copy-on-write; there is no copying fork
+     without the frame table. */
+  [SYS_FORK] = {sys_fork, 0, {0}, 0},
+#endif
+  [SYS_RSS_LIMIT] = {sys_rss_limit, 1, {ARG_VALUE}, 0},
+  [SYS_MMAP_POPULATE] = {sys_mmap_populate, 2, {ARG_VALUE, ARG_VALUE}, 0},
+  [SYS_MSYNC] = {sys_msync, 3, {ARG_VALUE, ARG_VALUE, ARG_VALUE}, 0},
+  [SYS_MADVISE] = {sys_madvise, 3, {ARG_VALUE, ARG_VALUE, ARG_VALUE}, 0},
+  [SYS_VMSTAT] = {sys_vmstat, 1, {ARG_OUT_FIXED}, sizeof (struct vmstat)},
+  [SYS_READV] = {sys_readv, 3, {ARG_VALUE, ARG_IOV_OUT, ARG_VALUE}, 0},
+  [SYS_WRITEV] = {sys_writev, 3, {ARG_VALUE, ARG_IOV_IN, ARG_VALUE}, 0},
+  [SYS_PREAD] = {sys_pread, 4, {ARG_VALUE, ARG_OUT, ARG_VALUE, ARG_VALUE}, 0},
+  [SYS_PWRITE] = {sys_pwrite, 4, {ARG_VALUE, ARG_IN, ARG_VALUE, ARG_VALUE}, 0},
+  [SYS_AIO_SETUP] = {sys_aio_setup, 1, {ARG_VALUE}, 0},
+  [SYS_AIO_ENTER] = {sys_aio_enter, 2, {ARG_VALUE, ARG_VALUE}, 0},
+};
+
+/* Copies the system call number and arguments in from the user
+   stack, checks every pointer argument once, and dispatches
+   through syscall_table.  Terminates the process on a bad number
+   or argument, before the call has taken any locks. */
 static void
-syscall_handler(struct intr_frame *f UNUSED)
+syscall_handler(struct intr_frame *f)
 {
-  int *p = f->esp;
-  //printf("%d", *p);
-
-  address_checking(p);
+  uint32_t *esp = f->esp;
+  uint32_t arg[4];
+  const struct syscall_desc *desc;
 
-  bool writeb = (f->error_code & PF_W) != 0;
-  bool userb = (f->error_code & PF_U) != 0;
+  check_user_range(esp, sizeof *esp, false);
+  if (*esp >= sizeof syscall_table / sizeof *syscall_table
+      || syscall_table[*esp].func == NULL)
+    exit(-1);
+  desc = &syscall_table[*esp];
 
-  //printf ("System call: %d\n", *p);
-  switch (*p)
+  check_user_range(esp + 1, desc->argc * sizeof *arg, false);
+  memcpy(arg, esp + 1, desc->argc * sizeof *arg);
+  for (int i = 0; i < desc->argc; i++)
   {
-  //
-  case SYS_HALT:
-    halt();
-    break;
-  case SYS_EXIT:
-    address_checking(p + 1);
-    exit(*(p + 1));
-    break;
-  case SYS_EXEC:
-    address_checking(p + 1);
-    f->eax = exec(*(p + 1));
-    break;
-  case SYS_WAIT:
-    address_checking(p + 1);
-    f->eax = wait(*(p + 1));
-    break;
-
-  //
-  case SYS_CREATE:
-    address_checking(p + 2);
-    f->eax = create(*(p + 1), *(p + 2));
-    break;
-  case SYS_REMOVE:
-    f->eax = remove(*(p + 1));
-    break;
-  case SYS_OPEN:
-    file_lock_acquire();
-    f->eax = open(*(p + 1));
-    file_lock_release();
-    break;
-  case SYS_FILESIZE:
-    address_checking(p + 1);
-    f->eax = filesize(*(p + 1));
-    break;
-  case SYS_READ:
-    address_checking(p + 1);
-    address_checking(p + 3);
-    file_lock_acquire();
-    f->eax = read(*(p + 1), *(p + 2), *(p + 3));
-    file_lock_release();
-    break;
-  case SYS_WRITE:
-    address_checking(p + 1);
-    address_checking(p + 3);
-    //printf("sys_write\n");
-    file_lock_acquire();
-    f->eax = write(*(p + 1), *(p + 2), *(p + 3));
-    file_lock_release();
-    //printf("sys_write\n");
-    break;
-  case SYS_SEEK:
-    address_checking(p + 1);
-    address_checking(p + 2);
-    seek(*(p + 1), *(p + 2));
-    break;
-  case SYS_TELL:
-    address_checking(p + 1);
-    f->eax = tell(*(p + 1));
-    break;
-  case SYS_CLOSE:
-    address_checking(p + 1);
-    close(*(p + 1));
-    break;
-  case SYS_MMAP: 
-    address_checking(p + 1);
-    address_checking(p + 2);
-    f->eax = mmap(*(p + 1), *(p + 2));
-    break;
-  case SYS_MUNMAP: 
-    address_checking(p + 1);
-    munmap(*(p + 1));
-    break;
+    void *uaddr = (void *) arg[i];
+    switch (desc->args[i])
+    {
+    case ARG_VALUE:
+      break;
+    case ARG_STRING:
+      check_user_string(uaddr);
+      break;
+    case ARG_IN:
+      check_user_range(uaddr, arg[i + 1], false);
+      break;
+    case ARG_OUT:
+      check_user_range(uaddr, arg[i + 1], true);
+      break;
+    case ARG_OUT_FIXED:
+      check_user_range(uaddr, desc->size, true);
+      break;
+    case ARG_IOV_IN:
+    case ARG_IOV_OUT:
+      check_user_iovec(uaddr, arg[i + 1], desc->args[i] == ARG_IOV_OUT);
+      break;
+    }
   }
+
+  f->eax = desc->func(arg, f);
 }
 
-void address_checking(int * p)
+/* Returns true if [UADDR, UADDR + SIZE) lies in the current
+   process's memory areas, writable ones if WRITE, growing the
+   stack to cover it if need be.  Costs one tree lookup per area
+   the range spans, not one per page.  Pages are not loaded here;
+   the kernel faults them in on first touch like the process
+   would. */
+bool
+user_range_ok(const void *uaddr, size_t size, bool write)
 {
-  if (!is_user_vaddr(p))
+  struct thread *t = thread_current();
+  const uint8_t *addr = pg_round_down(uaddr);
+  const uint8_t *end = (const uint8_t *) uaddr + size;
+
+  if (size == 0)
+    return true;
+  if (end < (const uint8_t *) uaddr || !is_user_vaddr(end - 1))
+    return false;
+  while (addr < end)
   {
+    struct vma *vma = vma_find(&t->stable, addr);
+    if (vma == NULL)
+    {
+      if (!stable_stack_alloc((void *) addr))
+        return false;
+      continue;
+    }
+    if (write && !vma->writable)
+      return false;
+    addr = vma->end;
+  }
+  return true;
+}
+
+/* Like user_range_ok(), but terminates the process if the range
+   is bad. */
+static void
+check_user_range(const void *uaddr, size_t size, bool write)
+{
+  if (!user_range_ok(uaddr, size, write))
+    exit(-1);
+}
+
+/* Checks an array of IOVCNT iovecs at IOV and each buffer it
+   names, writable ones if WRITE.  Terminates the process if any
+   of them is bad or IOVCNT is over IOV_MAX. */
+static void
+check_user_iovec(const struct iovec *iov, unsigned iovcnt, bool write)
+{
+  if (iovcnt > IOV_MAX)
     exit(-1);
+  check_user_range(iov, iovcnt * sizeof *iov, false);
+  for (unsigned i = 0; i < iovcnt; i++)
+    check_user_range(iov[i].iov_base, iov[i].iov_len, write);
+}
+
+/* Checks that the null-terminated string at USTR lies in the
+   current process's memory areas, and terminates the process if
+   not. */
+static void
+check_user_string(const char *ustr)
+{
+  const char *page = NULL;
+
+  for (;; ustr++)
+  {
+    if (pg_round_down(ustr) != page)
+    {
+      page = pg_round_down(ustr);
+      check_user_range(page, 1, false);
+    }
+    if (*ustr == '\0')
+      return;
   }
 }
 
+static uint32_t
+sys_halt(const uint32_t *arg UNUSED, struct intr_frame *f UNUSED)
+{
+  halt();
+  NOT_REACHED();
+}
 
+static uint32_t
+sys_exit(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  exit(arg[0]);
+  NOT_REACHED();
+}
 
+static uint32_t
+sys_exec(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return exec((const char *) arg[0]);
+}
+
+static uint32_t
+sys_wait(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return wait(arg[0]);
+}
+
+static uint32_t
+sys_create(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return create((const char *) arg[0], arg[1]);
+}
+
+static uint32_t
+sys_remove(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return remove((const char *) arg[0]);
+}
+
+static uint32_t
+sys_open(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return open((const char *) arg[0]);
+}
+
+static uint32_t
+sys_filesize(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return filesize(arg[0]);
+}
+
+static uint32_t
+sys_read(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return read(arg[0], (void *) arg[1], arg[2]);
+}
+
+static uint32_t
+sys_write(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return write(arg[0], (const void *) arg[1], arg[2]);
+}
+
+static uint32_t
+sys_seek(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  seek(arg[0], arg[1]);
+  return 0;
+}
+
+static uint32_t
+sys_tell(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return tell(arg[0]);
+}
+
+static uint32_t
+sys_close(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  close(arg[0]);
+  return 0;
+}
+
+static uint32_t
+sys_mmap(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return mmap(arg[0], (void *) arg[1]);
+}
+
+static uint32_t
+sys_munmap(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  munmap(arg[0]);
+  return 0;
+}
+
+#ifdef VM
+static uint32_t
+sys_fork(const uint32_t *arg UNUSED, struct intr_frame *f)
+{
+  return process_fork(f);
+}
+#endif
+
+static uint32_t
+sys_rss_limit(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return rss_limit(arg[0]);
+}
+
+static uint32_t
+sys_mmap_populate(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return mmap_populate(arg[0], (void *) arg[1]);
+}
+
+static uint32_t
+sys_msync(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return stable_msync(arg[0], arg[1], arg[2]);
+}
+
+static uint32_t
+sys_madvise(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return stable_madvise((void *) arg[0], arg[1], arg[2]);
+}
+
+static uint32_t
+sys_vmstat(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  vmstat_read((struct vmstat *) arg[0]);
+  return 0;
+}
+
+static uint32_t
+sys_readv(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return readv(arg[0], (const struct iovec *) arg[1], arg[2]);
+}
+
+static uint32_t
+sys_writev(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return writev(arg[0], (const struct iovec *) arg[1], arg[2]);
+}
+
+static uint32_t
+sys_pread(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return pread(arg[0], (void *) arg[1], arg[2], arg[3]);
+}
+
+static uint32_t
+sys_pwrite(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return pwrite(arg[0], (const void *) arg[1], arg[2], arg[3]);
+}
+
+static uint32_t
+sys_aio_setup(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return aio_setup((struct aio_ring *) arg[0]);
+}
+
+static uint32_t
+sys_aio_enter(const uint32_t *arg, struct intr_frame *f UNUSED)
+{
+  return aio_enter(arg[0], arg[1]);
+}
 
 //
 void halt(void)
@@ -165,17 +430,12 @@ void halt(void)
 void exit(int status)
 {
   thread_close(status);
-  if(file_lock.holder == thread_current()){
-    file_lock_release();
-  }
   printf("%s: exit(%d)\n", thread_current()->name, status);
   thread_exit();
 }
 
 pid_t exec(const char *cmd_line)
 {
-  address_checking(cmd_line);
-
   char * ptr;
   char * cmd_line_cp = malloc(strlen(cmd_line) + 1);
   strlcpy(cmd_line_cp, cmd_line, strlen(cmd_line) + 1);
@@ -199,21 +459,14 @@ int wait(pid_t pid)
 
 //
 bool create(const char * file, unsigned initial_size){
-  address_checking(file);
-  file_checking(file);
   return filesys_create(file, initial_size);
 }
 
 bool remove(const char * file){
-  address_checking(file);
-  file_checking(file);
   return filesys_remove(file);
 }
 
 int open(const char * file){
-  address_checking(file);
-  file_checking(file);
-
   struct file * fp = filesys_open(file);
   if(fp){
     for(int i = 3; i < 128; i++){
@@ -239,8 +492,6 @@ int filesize(int fd) {
 
 int read(int fd, void * b, unsigned size){
   uint8_t *buffer = b;
-  address_checking(buffer);
-  buffer_checking(buffer, size);
   if(fd == 0){
     for(int i = 0; i < size; i++){
       buffer[i] = input_getc();
@@ -248,8 +499,13 @@ int read(int fd, void * b, unsigned size){
     return size;
   }
   else{
-    if(thread_current()->fd[fd] != NULL){
-      return file_read(thread_current()->fd[fd], buffer, size);
+    struct file *file = fd_file(fd);
+    if(file != NULL){
+      int n = file_io(file, buffer, size, file_tell(file), true);
+      if(n > 0){
+        file_seek(file, file_tell(file) + n);
+      }
+      return n;
     }
     else{
       return -1;
@@ -259,18 +515,19 @@ int read(int fd, void * b, unsigned size){
 
 int write(int fd, const void *buffer, unsigned size)
 {
-  address_checking(buffer);
-  buffer_checking(buffer, size);
-
   if (fd == 1)
   {
     putbuf(buffer, size);
     return size;
   }
   else{
-    if(thread_current()->fd[fd] != NULL){
-      int buf = file_write(thread_current()->fd[fd], buffer, size);
-      return buf;
+    struct file *file = fd_file(fd);
+    if(file != NULL){
+      int n = file_io(file, (void *) buffer, size, file_tell(file), false);
+      if(n > 0){
+        file_seek(file, file_tell(file) + n);
+      }
+      return n;
     }
     else{
       return -1;
@@ -278,6 +535,96 @@ int write(int fd, const void *buffer, unsigned size)
   }
 }
 
+/* Reads into each of IOVCNT buffers in turn, stopping at the
+   first short read.  Returns the total number of bytes read, or -1
+   if the first read fails. */
+int readv(int fd, const struct iovec *iov, int iovcnt){
+  int total = 0;
+  for(int i = 0; i < iovcnt; i++){
+    int n = read(fd, iov[i].iov_base, iov[i].iov_len);
+    if(n < 0){
+      return total > 0 ? total : -1;
+    }
+    total += n;
+    if((size_t) n < iov[i].iov_len){
+      break;
+    }
+  }
+  return total;
+}
+
+/* Writes each of IOVCNT buffers in turn, like readv(). */
+int writev(int fd, const struct iovec *iov, int iovcnt){
+  int total = 0;
+  for(int i = 0; i < iovcnt; i++){
+    int n = write(fd, iov[i].iov_base, iov[i].iov_len);
+    if(n < 0){
+      return total > 0 ? total : -1;
+    }
+    total += n;
+    if((size_t) n < iov[i].iov_len){
+      break;
+    }
+  }
+  return total;
+}
+
+/* Reads SIZE bytes at OFFSET in the file open as FD, leaving its
+   position alone.  Returns the number of bytes read, or -1 if FD
+   is not an open file. */
+int pread(int fd, void *buffer, unsigned size, unsigned offset){
+  struct file *file = fd_file(fd);
+  if(file == NULL || (off_t) offset < 0){
+    return -1;
+  }
+  return file_io(file, buffer, size, offset, true);
+}
+
+/* Writes SIZE bytes at OFFSET, like pread(). */
+int pwrite(int fd, const void *buffer, unsigned size, unsigned offset){
+  struct file *file = fd_file(fd);
+  if(file == NULL || (off_t) offset < 0){
+    return -1;
+  }
+  return file_io(file, (void *) buffer, size, offset, false);
+}
+
+/* Returns the file open as FD, or NULL. */
+struct file *fd_file(int fd){
+  if(fd < 0 || fd >= 131){
+    return NULL;
+  }
+  return thread_current()->fd[fd];
+}
+
+/* Reads (if IS_READ) or writes SIZE bytes between FILE, starting
+   at OFFSET, and the user BUFFER.  Each piece of up to IO_CHUNK
+   bytes is pinned first, so that no page fault happens while the
+   inode's lock is held: a fault could evict a dirty page mapped
+   from the same file, whose write-back needs that lock.  Returns
+   the number of bytes transferred, or -1 if nothing could be. */
+static int file_io(struct file *file, void *buffer, unsigned size, off_t offset, bool is_read){
+  unsigned done = 0;
+  while(done < size){
+    uint8_t *chunk = (uint8_t *) buffer + done;
+    unsigned chunk_size = IO_CHUNK - pg_ofs(chunk);
+    if(chunk_size > size - done){
+      chunk_size = size - done;
+    }
+    if(!stable_pin(chunk, chunk_size, is_read)){
+      return done > 0 ? (int) done : -1;
+    }
+    off_t n = is_read ? file_read_at(file, chunk, chunk_size, offset + done)
+                      : file_write_at(file, chunk, chunk_size, offset + done);
+    stable_unpin(chunk, chunk_size);
+    done += n;
+    if(n < (off_t) chunk_size){
+      break;
+    }
+  }
+  return done;
+}
+
 void seek(int fd, unsigned position) {
   file_seek(thread_current()->fd[fd], position);
 }
@@ -300,47 +647,53 @@ void close(int fd) {
 }
 
 mapid_t mmap(int fd, void* addr){
-  mapid_t mapping = mapid;
+  mapid_t mapping;
+  return mmap_file(fd, addr, &mapping) != NULL ? mapping : -1;
+}
+
+/* Like mmap(), but reads the whole file in before returning, so
+   later accesses do not fault. */
+mapid_t mmap_populate(int fd, void* addr){
+  mapid_t mapping;
+  struct vma *vma = mmap_file(fd, addr, &mapping);
+  if(vma == NULL){
+    return -1;
+  }
+  stable_populate(vma, vma->start, vma->end);
+  return mapping;
+}
+
+/* Maps the file open as FD at ADDR and stores its new mapping id
+   in *MAPPING.  Returns the new area, or NULL on failure. */
+static struct vma *mmap_file(int fd, void* addr, mapid_t *mapping){
+  *mapping = mapid;
   lock_acquire(&mapid_lock);
   mapid++;
   lock_release(&mapid_lock);
   struct thread *t = thread_current();
-  struct file * file = file_reopen(t->fd[fd]);
-  void * upage = addr;
-  off_t offset = 0;
-  uint32_t read_bytes = file_length(file);
-  uint32_t zero_bytes = PGSIZE - (read_bytes % PGSIZE);
- 
-  while(read_bytes > 0 || zero_bytes > 0){
-    size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-    size_t page_zero_bytes = PGSIZE - page_read_bytes;
-    if(read_bytes == 0 && zero_bytes == PGSIZE)
-      break;
-    if(upage == NULL || upage != pg_round_down(upage) ||stable_is_exist(t, upage)){
-      munmap(mapping);
-      return -1;
-    }
-    stable_alloc(upage, file, offset, page_read_bytes, true, mapping);
-
-    offset += page_read_bytes;
-    read_bytes -= page_read_bytes;
-    zero_bytes -= page_zero_bytes;
-    upage += PGSIZE;
+  if(fd < 0 || fd >= 131 || t->fd[fd] == NULL){
+    return NULL;
   }
-  file_close(file);
-  return mapping;
+  struct file * file = t->fd[fd];
+  off_t length = file_length(file);
+  if(addr == NULL || length == 0){
+    return NULL;
+  }
+  return stable_map(addr, DIV_ROUND_UP(length, PGSIZE), file, 0, length, true, *mapping);
 }
 
 void munmap(mapid_t mapping){
   stable_munmap(mapping);
 }
 
-//
-void file_checking(const char * file){
-  if(file == NULL){
-    // printf("exit file checking");
-    exit(-1);
-  }
+/* Sets the current process's resident set limit to PAGES, or back
+   to the system default if PAGES is 0.  Returns the limit that was
+   in effect, 0 meaning unlimited. */
+unsigned rss_limit(unsigned pages){
+  struct thread *t = thread_current();
+  unsigned old = frame_rss_limit(t);
+  t->rss_limit = pages;
+  return old;
 }
 
 void thread_close(int status){
@@ -351,29 +704,3 @@ void thread_close(int status){
     }
   }
 }
-
-void buffer_checking(void *b, unsigned size){
-  void *buffer = b;
-  int cunt = size / PGSIZE + 1;
-  int zero_bytes = size % PGSIZE;
-  for(int i = 0; i < cunt; i ++){
-    struct stable_entry *entry = stable_find_entry(thread_current(), buffer);
-    if(entry != NULL && !entry->is_loaded){
-      stable_frame_alloc(entry->vaddr);
-    }
-    else if(entry == NULL){
-      entry = stable_alloc(buffer, NULL, 0, PGSIZE, true, -1);
-      stable_frame_alloc(entry->vaddr);
-    }
-    buffer += PGSIZE;
-  }
-
-}
-
-void file_lock_acquire(void){
-  lock_acquire(&file_lock);
-}
-
-void file_lock_release(void){
-  lock_release(&file_lock);
-}
\ No newline at end of file
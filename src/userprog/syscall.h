@@ -1,11 +1,20 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include "threads/vaddr.h"
+
 #define PF_P 0x1    /* 0: not-present page. 1: access rights violation. */
 #define PF_W 0x2    /* 0: read, 1: write. */
 #define PF_U 0x4    /* 0: kernel, 1: user process. */
 
 typedef int pid_t;
 
+/* Most of a user buffer pinned at once for file I/O. */
+#define IO_CHUNK (16 * PGSIZE)
+
 void syscall_init (void);
+bool user_range_ok (const void *uaddr, size_t size, bool write);
+struct file *fd_file (int fd);
 #endif /* userprog/syscall.h */
@@ -1,145 +1,1134 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include "threads/pte.h"
 #include "userprog/pagedir.h"
 #include "vm/swap.h"
 #include "vm/page.h"
 #include "vm/frame.h"
+#include "vm/vmstat.h"
+#include "filesys/file.h"
 
 static struct lock frame_lock;
-static struct list frame_table;
-static bool frame_less(struct list_elem *a, struct list_elem *b, void *aux);
+static struct condition frame_evicted;  // signalled when an eviction finishes
+static struct frame_entry *frame_table; // indexed by user pool page number
+static size_t frame_cnt;                // number of frames in the user pool
+static size_t frame_hand;               // clock hand, persists across evictions
+static uint8_t *frame_base;             // kernel address of user pool frame 0
+static size_t frame_evicting;           // frames pinned by in-flight evictions
+static void *frame_zero;                // kernel page of zeros, mapped read-only
 
-void frame_init(){
-    list_init(&frame_table);
+/* Pageout daemon.  It is woken when the number of free user
+   frames drops below frame_low_water and evicts until there are
+   frame_high_water free frames again, so most page faults find a
+   free frame without doing any disk I/O themselves. */
+static size_t frame_low_water;
+static size_t frame_high_water;
+static struct semaphore pageout_sema;
+
+/* Text page cache.  Read-only pages of executables, keyed by inode,
+   file offset and length, so processes running the same program
+   map one frame instead of each reading its own copy.  Holds only
+   frames that have sharers; a frame leaves the cache when it is
+   freed or chosen for eviction. */
+static struct hash frame_cache;
+
+/* Resident set limit for processes that did not set their own.
+   A process allocating beyond its limit evicts one of its own
+   pages first, so a memory hog mostly pages against itself. */
+static size_t frame_rss_default;
+
+/* Page replacement policies.  The frame table tells the policy
+   when a frame starts and stops holding a page and asks it for
+   eviction victims; the policy is chosen at boot.  All hooks run
+   under frame_lock, and select() must skip frames that are free,
+   pinned or part of a large page. */
+struct frame_policy {
+    const char *name;
+    void (*insert)(struct frame_entry *frame);  // got its first sharer
+    void (*remove)(struct frame_entry *frame);  // about to be freed
+    struct frame_entry *(*select)(void);        // victim, or NULL
+};
+
+static struct frame_entry *clock_select(void);
+static void wsclock_insert(struct frame_entry *frame);
+static struct frame_entry *wsclock_select(void);
+static void twoq_insert(struct frame_entry *frame);
+static void twoq_remove(struct frame_entry *frame);
+static struct frame_entry *twoq_select(void);
+
+static const struct frame_policy frame_policies[] = {
+    {"clock", NULL, NULL, clock_select},
+    {"wsclock", wsclock_insert, NULL, wsclock_select},
+    {"2q", twoq_insert, twoq_remove, twoq_select},
+};
+static const struct frame_policy *frame_policy;
+
+/* WSClock: a page not accessed for this many ticks has left its
+   process's working set. */
+#define WSCLOCK_TAU (TIMER_FREQ / 2)
+
+/* 2Q: pages enter twoq_a1 and move to twoq_am once referenced
+   again, so pages touched only once, such as a sequential scan,
+   are evicted before pages that are in real use.  Both queues are
+   FIFO with a second chance for pages referenced while queued. */
+static struct list twoq_a1;
+static struct list twoq_am;
+#define TWOQ_A1_SHARE 4     // a1 is evicted from first above 1/4 of frames
+
+/* Same-page merging.  ksmd walks the frame table a few frames at a
+   time and merges frames of private, writable memory that hold the
+   same bytes into one frame shared copy-on-write; a write splits
+   it again through frame_unshare().  A frame is only considered
+   once its checksum is the same as on the previous pass, so pages
+   being written are left alone.  Considering a frame maps it
+   read-only, so a later write costs a fault but no copy.  Merged
+   frames are in ksm_stable, keyed by contents.  Frames seen
+   unchanged once wait in ksm_unstable, keyed by checksum, for a
+   twin; that table is emptied after each pass, since its frames
+   may have changed. */
+static struct hash ksm_stable;
+static struct hash ksm_unstable;
+static size_t ksm_batch;    // frames scanned per wakeup, 0 if off
+static size_t ksm_hand;
+static unsigned long long ksm_merge_cnt;
+#define KSM_INTERVAL (TIMER_FREQ / 10)
+
+#define FRAME_LOW_WATER_MIN 4
+#define FRAME_EVICT_BATCH 8     // most victims evicted and swapped together
+
+static struct frame_entry *frame_lookup(void *kpage);
+static struct stable_entry *frame_first(struct frame_entry *frame);
+static void frame_add_sharer(struct frame_entry *frame, struct stable_entry *entry);
+static void frame_remove_sharer(struct stable_entry *entry);
+static void frame_release(struct frame_entry *frame);
+static bool frame_needs_write(struct frame_entry *frame);
+static struct frame_entry *frame_pick_owned(struct thread *t);
+static bool frame_over_limit(struct thread *t, size_t cnt);
+static bool frame_is_accessed(struct frame_entry *frame);
+static bool frame_is_dirty(struct frame_entry *frame);
+static bool frame_sharer_dirty(struct frame_entry *frame);
+static bool frame_is_large(struct frame_entry *frame);
+static size_t frame_evict(size_t cnt, struct thread *owner);
+static size_t frame_evict_batch(size_t cnt, struct thread *owner, bool *kept_any);
+static bool frame_is_cacheable(struct stable_entry *entry);
+static struct frame_entry *frame_cache_find(struct stable_entry *entry);
+static void frame_uncache(struct frame_entry *frame);
+static unsigned frame_cache_hash(const struct hash_elem *e, void *aux UNUSED);
+static bool frame_cache_less(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED);
+static void frame_lock_acquire(void);
+static bool frame_is_pinned(struct frame_entry *frame);
+static void pageout_daemon(void *aux UNUSED);
+static void ksm_daemon(void *aux UNUSED);
+static void ksm_scan(struct frame_entry *frame);
+static void ksm_forget(struct frame_entry *frame);
+static unsigned ksm_stable_hash(const struct hash_elem *e, void *aux UNUSED);
+static bool ksm_stable_less(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED);
+static bool ksm_unstable_less(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED);
+
+/* Must run after palloc_init() and malloc_init().  LOW_WATER is
+   the number of user frames the pageout daemon keeps free; 0
+   selects a default based on the size of the user pool.  RSS_LIMIT
+   is the default resident set limit, 0 for none.  POLICY names the
+   page replacement policy, or is null for the clock. */
+void frame_init(size_t low_water, size_t rss_limit, const char *policy){
     lock_init(&frame_lock);
+    cond_init(&frame_evicted);
+    sema_init(&pageout_sema, 0);
+    hash_init(&frame_cache, frame_cache_hash, frame_cache_less, NULL);
+    hash_init(&ksm_stable, ksm_stable_hash, ksm_stable_less, NULL);
+    hash_init(&ksm_unstable, ksm_stable_hash, ksm_unstable_less, NULL);
+    frame_base = palloc_user_base();
+    frame_cnt = palloc_user_page_cnt();
+    frame_hand = 0;
+    frame_evicting = 0;
+    frame_zero = palloc_get_page(PAL_ASSERT | PAL_ZERO);
+    frame_table = calloc(frame_cnt, sizeof *frame_table);
+    if(frame_table == NULL && frame_cnt > 0){
+        PANIC("Frame table allocation failed");
+    }
+    for(size_t i = 0; i < frame_cnt; i++){
+        list_init(&frame_table[i].sharers);
+        frame_table[i].kpage = frame_base + i * PGSIZE;
+    }
+
+    if(low_water == 0){
+        low_water = frame_cnt / 64;
+        if(low_water < FRAME_LOW_WATER_MIN){
+            low_water = FRAME_LOW_WATER_MIN;
+        }
+    }
+    if(low_water > frame_cnt / 2){
+        low_water = frame_cnt / 2;
+    }
+    frame_low_water = low_water;
+    frame_high_water = low_water * 2;
+    frame_rss_default = rss_limit;
+
+    list_init(&twoq_a1);
+    list_init(&twoq_am);
+    frame_policy = &frame_policies[0];
+    if(policy != NULL){
+        size_t i;
+        for(i = 0; i < sizeof frame_policies / sizeof *frame_policies; i++){
+            if(!strcmp(policy, frame_policies[i].name)){
+                break;
+            }
+        }
+        if(i == sizeof frame_policies / sizeof *frame_policies){
+            PANIC("unknown page replacement policy `%s'", policy);
+        }
+        frame_policy = &frame_policies[i];
+    }
+}
+
+void frame_print_stats(void){
+    printf("Frame: %s replacement\n", frame_policy->name);
+    if(ksm_batch > 0){
+        printf("KSM: %llu pages merged, %zu shared frames\n", ksm_merge_cnt, hash_size(&ksm_stable));
+    }
 }
 
+/* Starts the pageout daemon.  Must run after thread_start() and
+   swap_init(). */
+void frame_pageout_init(void){
+    if(frame_low_water > 0){
+        thread_create("pageout", PRI_DEFAULT, pageout_daemon, NULL);
+    }
+}
+
+/* Starts the same-page merging thread, which scans BATCH frames
+   every KSM_INTERVAL ticks.  Does nothing if BATCH is 0.  Must run
+   after thread_start(). */
+void frame_ksm_init(size_t batch){
+    if(batch > 0){
+        ksm_batch = batch;
+        thread_create("ksmd", PRI_DEFAULT, ksm_daemon, NULL);
+    }
+}
+
+/* Enters KPAGE, already mapped at ENTRY's address, into the frame
+   table.  From here on the frame may be chosen for eviction, so
+   the entry is marked loaded under the same lock.  Read-only
+   executable pages also enter the text page cache, unless another
+   process loaded the same page first. */
 void frame_allocate(struct stable_entry* entry, void *kpage){
-    lock_acquire(&frame_lock);
-    struct frame_entry *frame = malloc(sizeof(struct frame_entry));
-    frame->thread = thread_current();
-    frame->user_addr = entry->vaddr;
-    frame->entry = entry;
-    frame->kpage = kpage;
-    if(list_size(&frame_table)){
-        list_push_back(&frame_table, &frame->elem);
+    frame_lock_acquire();
+    struct frame_entry *frame = frame_lookup(kpage);
+    ASSERT(list_empty(&frame->sharers));
+    frame->pinned = false;
+    frame->io_pins = 0;
+    frame->cached = false;
+    frame_add_sharer(frame, entry);
+    if(frame_is_cacheable(entry) && frame_cache_find(entry) == NULL){
+        frame->inode = file_get_inode(entry->vma->file);
+        frame->offset = stable_page_offset(entry);
+        frame->read_bytes = stable_page_read_bytes(entry);
+        frame->cached = true;
+        hash_insert(&frame_cache, &frame->cache_elem);
     }
-    else{
-        list_insert_ordered(&frame_table, &frame->elem, &frame_less, NULL);
+    lock_release(&frame_lock);
+}
+
+/* Maps ENTRY's page from the text page cache if another process
+   already has it in memory.  Returns false if ENTRY is not a
+   read-only executable page or the page is not cached. */
+bool frame_map_cached(struct stable_entry *entry){
+    bool success = false;
+    if(!frame_is_cacheable(entry)){
+        return false;
     }
+    frame_lock_acquire();
+    struct frame_entry *frame = frame_cache_find(entry);
+    if(frame != NULL
+       && pagedir_set_page(entry->vma->thread->pagedir, entry->vaddr, frame->kpage, false)){
+        pagedir_set_dirty(entry->vma->thread->pagedir, entry->vaddr, false);
+        frame_add_sharer(frame, entry);
+        success = true;
+    }
+    lock_release(&frame_lock);
+    return success;
+}
 
+/* Makes CHILD, the current thread's copy of PARENT's entry made by
+   fork, refer to the same page.  A resident private page is shared
+   copy-on-write: both mappings become read-only until one of them
+   writes.  Mapped file pages are shared writable.  A swapped page
+   shares its swap slot.  Returns false if out of memory, which
+   includes failing to split a large page: copy-on-write works
+   page by page. */
+bool frame_fork(struct stable_entry *parent, struct stable_entry *child){
+    bool success = true;
+    frame_lock_acquire();
+    while(parent->frame != NULL && parent->frame->pinned){
+        cond_wait(&frame_evicted, &frame_lock);
+    }
+    struct frame_entry *frame = parent->frame;
+    if(frame != NULL){
+        uint32_t *pagedir = parent->vma->thread->pagedir;
+        bool shared_file = parent->vma->file != NULL && parent->vma->mapid != -1;
+        bool cow = parent->vma->writable && !shared_file;
+        if(cow && !pagedir_demote(pagedir, parent->vaddr)){
+            lock_release(&frame_lock);
+            return false;
+        }
+        if(pagedir_is_dirty(pagedir, parent->vaddr)){
+            parent->dirty = child->dirty = true;
+        }
+        if(cow){
+            pagedir_set_writable(pagedir, parent->vaddr, false);
+            parent->cow = child->cow = true;
+        }
+        if(pagedir_set_page(child->vma->thread->pagedir, child->vaddr, frame->kpage,
+                            child->vma->writable && !child->cow)){
+            frame_add_sharer(frame, child);
+        }
+        else{
+            success = false;
+        }
+    }
+    else if((int) parent->swap_index != -1){
+        child->swap_index = swap_share(parent->swap_index);
+    }
     lock_release(&frame_lock);
+    return success;
 }
 
-void frame_deallocate(void * user_adder){
-    lock_acquire(&frame_lock);
-    struct list_elem *a;
-    struct frame_entry *entry_a;
-    for(a = list_begin(&frame_table); a != list_end(&frame_table); a = a->next){
-        entry_a = list_entry(a, struct frame_entry, elem);
-        if(entry_a->user_addr == user_adder){
-            list_remove(a);
-            pagedir_clear_page(entry_a->thread->pagedir, entry_a->user_addr);
-            palloc_free_page(entry_a->kpage);
-            free(entry_a);
+/* Handles a write to ENTRY's copy-on-write page.  If other
+   entries still share the frame, the current thread gets a
+   private copy; otherwise the page just becomes writable again,
+   without allocating anything. */
+void frame_unshare(struct stable_entry *entry){
+    uint32_t *pagedir = entry->vma->thread->pagedir;
+    uint8_t *kpage = NULL;
+
+    frame_lock_acquire();
+    for(;;){
+        while(entry->frame != NULL && entry->frame->pinned){
+            cond_wait(&frame_evicted, &frame_lock);
+        }
+        struct frame_entry *frame = entry->frame;
+        if(frame == NULL || !entry->cow){
+            /* Evicted or already unshared meanwhile; retrying the
+               access sorts it out. */
+            break;
+        }
+        if(list_size(&frame->sharers) == 1){
+            ksm_forget(frame);
+            pagedir_set_writable(pagedir, entry->vaddr, true);
+            entry->cow = false;
             break;
         }
+        if(kpage == NULL){
+            /* frame_kpage() may evict, which needs the lock, so
+               look again afterwards. */
+            lock_release(&frame_lock);
+            kpage = frame_kpage(0);
+            frame_lock_acquire();
+            continue;
+        }
+        memcpy(kpage, frame->kpage, PGSIZE);
+        frame_remove_sharer(entry);
+        pagedir_clear_page(pagedir, entry->vaddr);
+        pagedir_set_page(pagedir, entry->vaddr, kpage, true);
+        entry->cow = false;
+        entry->dirty = true;
+        frame = frame_lookup(kpage);
+        frame->pinned = false;
+        frame_add_sharer(frame, entry);
+        kpage = NULL;
+        break;
     }
     lock_release(&frame_lock);
+
+    if(kpage != NULL){
+        palloc_free_page(kpage);
+    }
 }
 
-void frame_thread_remove(struct thread* t){
-    lock_acquire(&frame_lock);
-    struct list_elem *a;
-    struct frame_entry *entry_a;
-    for(a = list_begin(&frame_table); a != list_end(&frame_table); ){
-        struct list_elem *b = a;
-        a = a->next;        
-        entry_a = list_entry(b, struct frame_entry, elem);
-        if(entry_a->thread == t){
-            list_remove(b);
-            free(entry_a);
+/* Releases ENTRY's frame, if it has one, or its mapping of the
+   zero frame.  The frame is found through the entry's
+   back-pointer, so this does not depend on the number of resident
+   frames.  If the frame is being evicted or is pinned for I/O,
+   waits for that to finish first.  A large page is split first;
+   returns false, changing nothing, if that runs out of memory. */
+bool frame_deallocate(struct stable_entry *entry){
+    frame_lock_acquire();
+    while(entry->frame != NULL && frame_is_pinned(entry->frame)){
+        cond_wait(&frame_evicted, &frame_lock);
+    }
+    struct frame_entry *frame = entry->frame;
+    if(frame != NULL){
+        if(!pagedir_demote(entry->vma->thread->pagedir, entry->vaddr)){
+            lock_release(&frame_lock);
+            return false;
         }
+        pagedir_clear_page(entry->vma->thread->pagedir, entry->vaddr);
+        frame_remove_sharer(entry);
+        if(list_empty(&frame->sharers)){
+            frame_release(frame);
+        }
+        entry->frame = NULL;
+        entry->is_loaded = false;
+        entry->cow = false;
+    }
+    else if(entry->zero){
+        /* Must go before pagedir_destroy(), which would free it. */
+        pagedir_clear_page(entry->vma->thread->pagedir, entry->vaddr);
+        entry->zero = false;
+        entry->is_loaded = false;
     }
     lock_release(&frame_lock);
+    return true;
 }
 
-void frame_destory(){
-    lock_acquire(&frame_lock);
-    struct list_elem *a;
-    struct frame_entry *entry_a;
+/* Keeps ENTRY's frame resident while the kernel does I/O to or
+   from it.  The frame is passed over by eviction and same-page
+   merging until frame_unpin(), so ENTRY keeps it.  Returns false
+   if ENTRY is not resident. */
+bool frame_pin(struct stable_entry *entry){
+    frame_lock_acquire();
+    while(entry->frame != NULL && entry->frame->pinned){
+        cond_wait(&frame_evicted, &frame_lock);
+    }
+    bool success = entry->frame != NULL;
+    if(success){
+        entry->frame->io_pins++;
+    }
+    lock_release(&frame_lock);
+    return success;
+}
 
-    for(a = list_begin(&frame_table); a != list_end(&frame_table); a = a->next){
-        entry_a = list_entry(a, struct frame_entry, elem);
-        list_remove(a);
-        palloc_free_page(entry_a->kpage);
-        free(entry_a);
+/* Undoes one frame_pin() of FRAME.  This takes the frame rather
+   than the entry so that a kernel thread doing I/O for a process
+   can unpin what it was handed. */
+void frame_unpin(struct frame_entry *frame){
+    frame_lock_acquire();
+    ASSERT(frame->io_pins > 0);
+    if(--frame->io_pins == 0){
+        cond_broadcast(&frame_evicted, &frame_lock);
     }
     lock_release(&frame_lock);
 }
 
+/* Returns true if ENTRY's frame is pinned for I/O. */
+bool frame_io_pinned(struct stable_entry *entry){
+    frame_lock_acquire();
+    bool pinned = entry->frame != NULL && entry->frame->io_pins > 0;
+    lock_release(&frame_lock);
+    return pinned;
+}
 
+/* Waits until ENTRY is not in the middle of being evicted.  After
+   this returns, is_loaded and swap_index describe where the page
+   really is. */
+void frame_wait_evicted(struct stable_entry *entry){
+    frame_lock_acquire();
+    while(entry->frame != NULL && entry->frame->pinned){
+        cond_wait(&frame_evicted, &frame_lock);
+    }
+    lock_release(&frame_lock);
+}
 
+/* Returns a user frame.  Normally the pageout daemon keeps a few
+   frames free and this never touches the disk; if the pool runs
+   dry anyway, the caller evicts a frame itself.  A process at its
+   resident set limit first gives up one of its own frames. */
 void * frame_kpage(enum palloc_flags flags){
-    lock_acquire(&frame_lock); 
+    if(frame_over_limit(thread_current(), 1)){
+        frame_evict(1, thread_current());
+    }
     void * kpage = palloc_get_page(PAL_USER | flags);
     while(!kpage){
-        struct frame_entry * frame_eviction = get_frame_eviction();
-        struct thread * t = frame_eviction->thread;
-         struct stable_entry * entry;
-        entry = frame_eviction->entry;
-        if(entry->file != NULL && entry->mapid != -1){
-            stable_write_back(entry);
+        if(frame_evict(1, NULL) == 0){
+            frame_lock_acquire();
+            if(frame_evicting == 0){
+                PANIC("Evict Fail");
+            }
+            cond_wait(&frame_evicted, &frame_lock);
+            lock_release(&frame_lock);
+        }
+        kpage = palloc_get_page(PAL_USER | flags);
+    }
+
+    if(palloc_user_free_cnt() < frame_low_water){
+        sema_up(&pageout_sema);
+    }
+    return kpage;
+}
+
+/* Returns a free user frame if one is available right away and
+   the free pool is above the low watermark, otherwise NULL.  Used
+   for speculative reads, which must never cause eviction. */
+void * frame_kpage_try(enum palloc_flags flags){
+    if(palloc_user_free_cnt() <= frame_low_water || frame_over_limit(thread_current(), 1)){
+        return NULL;
+    }
+    return palloc_get_page(PAL_USER | flags);
+}
+
+/* Returns LARGE_PAGE_CNT zeroed frames for a 4 MB page, aligned
+   to 4 MB, or NULL if the user pool has no such run to spare above
+   the low watermark.  Never evicts: under memory pressure callers
+   use 4 kB pages instead. */
+void * frame_kpage_large(void){
+    if(palloc_user_free_cnt() < frame_low_water + LARGE_PAGE_CNT
+       || frame_over_limit(thread_current(), LARGE_PAGE_CNT)){
+        return NULL;
+    }
+    return palloc_get_aligned(PAL_USER | PAL_ZERO, LARGE_PAGE_CNT, LARGE_PAGE_CNT);
+}
+
+/* Returns CNT physically contiguous frames, so that a run of file
+   pages can be read with one request, or NULL if the user pool has
+   no such run to spare above the low watermark.  Never evicts. */
+void * frame_kpage_run(size_t cnt){
+    if(palloc_user_free_cnt() < frame_low_water + cnt
+       || frame_over_limit(thread_current(), cnt)){
+        return NULL;
+    }
+    return palloc_get_multiple(PAL_USER, cnt);
+}
+
+/* Returns T's resident set limit in pages, 0 if unlimited. */
+size_t frame_rss_limit(struct thread *t){
+    return t->rss_limit != 0 ? t->rss_limit : frame_rss_default;
+}
+
+/* Returns true if T would exceed its resident set limit by
+   mapping CNT more pages.  Read without frame_lock; the limit is
+   soft. */
+static bool frame_over_limit(struct thread *t, size_t cnt){
+    size_t limit = frame_rss_limit(t);
+    return limit != 0 && t->rss + cnt > limit;
+}
+
+/* Returns the frame of zeros that read faults on zero-fill pages
+   map read-only.  It comes from the kernel pool, so it is never in
+   the frame table and never evicted. */
+void * frame_zero_page(void){
+    return frame_zero;
+}
+
+/* Orders eviction victims by owner and then by user address, so a
+   batch written to consecutive swap slots keeps each process's
+   neighbouring pages next to each other on disk. */
+static bool frame_victim_less(struct frame_entry *a, struct frame_entry *b){
+    struct stable_entry *x = frame_first(a);
+    struct stable_entry *y = frame_first(b);
+    if(x->vma->thread != y->vma->thread){
+        return (uintptr_t) x->vma->thread < (uintptr_t) y->vma->thread;
+    }
+    return x->vaddr < y->vaddr;
+}
+
+/* Evicts up to CNT frames, at most FRAME_EVICT_BATCH.  Victims are
+   chosen and unmapped under frame_lock, but written out with the
+   lock released; they stay pinned meanwhile so nobody else picks
+   or frees them.  Dirty anonymous victims are swapped out together
+   in one batch; a victim that gets no swap slot is mapped back
+   in, marked accessed so the policy passes it over, and others
+   are tried instead, up to one sweep of the frame table.  If
+   OWNER is non-null, only frames that OWNER alone maps are taken.
+   Returns the number of frames evicted. */
+static size_t frame_evict(size_t cnt, struct thread *owner){
+    for(size_t tries = 0; tries <= frame_cnt / FRAME_EVICT_BATCH; tries++){
+        bool kept;
+        size_t evicted = frame_evict_batch(cnt, owner, &kept);
+        if(evicted > 0 || !kept){
+            return evicted;
+        }
+    }
+    return 0;
+}
+
+/* Does one round of frame_evict(), setting *KEPT_ANY if a victim had
+   to be mapped back in. */
+static size_t frame_evict_batch(size_t cnt, struct thread *owner, bool *kept_any){
+    struct frame_entry *victims[FRAME_EVICT_BATCH];
+    bool dirty[FRAME_EVICT_BATCH];
+    void *swap_pages[FRAME_EVICT_BATCH];
+    size_t swap_indexes[FRAME_EVICT_BATCH];
+    size_t swap_of[FRAME_EVICT_BATCH];  // victim's position in swap_pages
+    size_t victim_cnt = 0;
+    size_t swap_cnt = 0;
+    size_t kept = 0;
+
+    if(cnt > FRAME_EVICT_BATCH){
+        cnt = FRAME_EVICT_BATCH;
+    }
+
+    frame_lock_acquire();
+    while(victim_cnt < cnt){
+        struct frame_entry *frame = owner != NULL ? frame_pick_owned(owner) : get_frame_eviction();
+        if(frame == NULL){
+            break;
+        }
+        frame->pinned = true;
+        frame_evicting++;
+        frame_uncache(frame);
+
+        /* Insertion sort; batches are small. */
+        size_t i = victim_cnt++;
+        bool is_dirty = frame_is_dirty(frame);
+        for(; i > 0 && frame_victim_less(frame, victims[i - 1]); i--){
+            victims[i] = victims[i - 1];
+            dirty[i] = dirty[i - 1];
+        }
+        victims[i] = frame;
+        dirty[i] = is_dirty;
+
+        struct list_elem *e;
+        for(e = list_begin(&frame->sharers); e != list_end(&frame->sharers); e = list_next(e)){
+            struct stable_entry *entry = list_entry(e, struct stable_entry, frame_elem);
+            pagedir_clear_page(entry->vma->thread->pagedir, entry->vaddr);
+        }
+    }
+    lock_release(&frame_lock);
+
+    *kept_any = false;
+    if(victim_cnt == 0){
+        return 0;
+    }
+
+    /* Mapped files are written back to the file when modified.
+       Other pages only need swap if they were ever modified;
+       clean ones are dropped and refilled from the executable or
+       with zeros on the next fault. */
+    for(size_t i = 0; i < victim_cnt; i++){
+        struct stable_entry *entry = frame_first(victims[i]);
+        swap_of[i] = SIZE_MAX;
+        if(entry->vma->file != NULL && entry->vma->mapid != -1){
+            if(dirty[i]){
+                file_write_at(entry->vma->file, victims[i]->kpage, stable_page_read_bytes(entry), stable_page_offset(entry));
+                vmstat_evict(VMSTAT_EVICT_DIRTY);
+            }
+            else{
+                vmstat_evict(VMSTAT_EVICT_FILE);
+            }
+        }
+        else if(dirty[i] || frame_sharer_dirty(victims[i])){
+            swap_of[i] = swap_cnt;
+            swap_pages[swap_cnt++] = victims[i]->kpage;
+            entry->dirty = true;
         }
         else{
-            entry->swap_index = swap_out(frame_eviction->kpage);
+            vmstat_evict(stable_page_read_bytes(entry) > 0 ? VMSTAT_EVICT_FILE : VMSTAT_EVICT_CLEAN);
         }
-        entry->is_loaded = false;
-        pagedir_clear_page(t->pagedir, frame_eviction->user_addr);
-        palloc_free_page(frame_eviction->kpage);
-        list_remove(&frame_eviction->elem);
-        free(frame_eviction);
-        kpage = palloc_get_page(PAL_USER | flags);
     }
+    swap_out_batch(swap_pages, swap_cnt, swap_indexes);
 
+    /* Every entry sharing a frame gets a reference to its swap
+       slot; each one reads back a private copy. */
+    frame_lock_acquire();
+    for(size_t i = 0; i < victim_cnt; i++){
+        struct frame_entry *frame = victims[i];
+        size_t swap_index = swap_of[i] != SIZE_MAX ? swap_indexes[swap_of[i]] : (size_t) -1;
+        bool first = true;
+        if(swap_of[i] != SIZE_MAX){
+            if(swap_index == (size_t) -1){
+                /* Out of swap: the page has nowhere else to live. */
+                struct list_elem *e;
+                for(e = list_begin(&frame->sharers); e != list_end(&frame->sharers); e = list_next(e)){
+                    struct stable_entry *entry = list_entry(e, struct stable_entry, frame_elem);
+                    uint32_t *pagedir = entry->vma->thread->pagedir;
+                    pagedir_set_page(pagedir, entry->vaddr, frame->kpage, entry->vma->writable && !entry->cow);
+                    pagedir_set_accessed(pagedir, entry->vaddr, true);
+                }
+                frame->pinned = false;
+                *kept_any = true;
+                kept++;
+                continue;
+            }
+            vmstat_evict(VMSTAT_EVICT_SWAP);
+        }
+        while(!list_empty(&frame->sharers)){
+            struct stable_entry *entry = frame_first(frame);
+            frame_remove_sharer(entry);
+            if(swap_index != (size_t) -1){
+                entry->swap_index = first ? swap_index : swap_share(swap_index);
+                entry->dirty = true;
+            }
+            else{
+                entry->swap_index = -1;
+            }
+            entry->is_loaded = false;
+            entry->frame = NULL;
+            entry->cow = false;
+            first = false;
+        }
+        frame_release(frame);
+        frame->pinned = false;
+    }
+    frame_evicting -= victim_cnt;
+    cond_broadcast(&frame_evicted, &frame_lock);
     lock_release(&frame_lock);
+    return victim_cnt - kept;
+}
 
-    return kpage;
+/* Acquires frame_lock, counting how often and how long threads
+   wait for it. */
+static void frame_lock_acquire(void){
+    if(lock_try_acquire(&frame_lock)){
+        vmstat_frame_lock(false, 0);
+        return;
+    }
+    int64_t start = timer_ticks();
+    lock_acquire(&frame_lock);
+    vmstat_frame_lock(true, timer_elapsed(start));
 }
 
-struct frame_entry * get_frame_eviction(){
-    uint32_t * pagedir;
-    struct list_elem *a;
-    struct frame_entry *entry_a;
-    int max_repeat = 3;
-    while(max_repeat > 0){
-        max_repeat --;
-        for(a = list_begin(&frame_table); a != list_end(&frame_table); a = a->next){
-            entry_a = list_entry(a, struct frame_entry, elem);
-            pagedir = entry_a->thread->pagedir;
-            struct stable_entry * sentry = entry_a->entry;
-            if(sentry!= NULL){
-                    if(pagedir_is_accessed(pagedir, entry_a->user_addr)){
-                        pagedir_set_accessed(pagedir, entry_a->user_addr, false);
-                        continue;
-                    }
-                    else{
-                        break;
+/* Returns true if FRAME may not be evicted or merged: it is being
+   evicted already or is pinned for I/O. */
+static bool frame_is_pinned(struct frame_entry *frame){
+    return frame->pinned || frame->io_pins > 0;
+}
+
+static void pageout_daemon(void *aux UNUSED){
+    for(;;){
+        sema_down(&pageout_sema);
+        size_t free_cnt = palloc_user_free_cnt();
+        while(free_cnt < frame_high_water){
+            if(frame_evict(frame_high_water - free_cnt, NULL) == 0){
+                break;
+            }
+            free_cnt = palloc_user_free_cnt();
+        }
+    }
+}
+
+static void ksm_daemon(void *aux UNUSED){
+    for(;;){
+        timer_sleep(KSM_INTERVAL);
+        for(size_t i = 0; i < ksm_batch; i++){
+            frame_lock_acquire();
+            ksm_scan(&frame_table[ksm_hand]);
+            if(++ksm_hand == frame_cnt){
+                ksm_hand = 0;
+                hash_clear(&ksm_unstable, NULL);
+                for(size_t j = 0; j < frame_cnt; j++){
+                    if(frame_table[j].ksm == KSM_UNSTABLE){
+                        frame_table[j].ksm = KSM_NONE;
                     }
+                }
             }
+            lock_release(&frame_lock);
         }
     }
+}
 
-    if(entry_a == NULL){
-        PANIC("Evict Fail");
+/* Returns true if FRAME holds a page that may be merged: resident,
+   not being evicted, not a file page or part of a large page, and
+   private and writable in every process mapping it. */
+static bool ksm_is_mergeable(struct frame_entry *frame){
+    struct list_elem *e;
+    if(list_empty(&frame->sharers) || frame_is_pinned(frame) || frame->cached || frame_is_large(frame)){
+        return false;
+    }
+    for(e = list_begin(&frame->sharers); e != list_end(&frame->sharers); e = list_next(e)){
+        struct stable_entry *entry = list_entry(e, struct stable_entry, frame_elem);
+        if(!entry->vma->writable || (entry->vma->file != NULL && entry->vma->mapid != -1)){
+            return false;
+        }
     }
+    return true;
+}
 
-    return entry_a;
+/* Maps FRAME read-only copy-on-write everywhere, so its contents
+   stay as they are until a write splits it off. */
+static void ksm_protect(struct frame_entry *frame){
+    struct list_elem *e;
+    for(e = list_begin(&frame->sharers); e != list_end(&frame->sharers); e = list_next(e)){
+        struct stable_entry *entry = list_entry(e, struct stable_entry, frame_elem);
+        uint32_t *pagedir = entry->vma->thread->pagedir;
+        if(pagedir_is_dirty(pagedir, entry->vaddr)){
+            entry->dirty = true;
+        }
+        pagedir_set_writable(pagedir, entry->vaddr, false);
+        entry->cow = true;
+    }
 }
 
-static bool frame_less(struct list_elem *a, struct list_elem *b, void *aux){
-    struct frame_entry *entry_a = list_entry(a, struct frame_entry, elem);
-    struct frame_entry *entry_b = list_entry(b, struct frame_entry, elem);
-    return entry_a->user_addr < entry_b->user_addr;
-}
\ No newline at end of file
+/* Moves every mapping of FRAME to INTO, which holds the same
+   bytes, and frees FRAME. */
+static void ksm_merge(struct frame_entry *frame, struct frame_entry *into){
+    while(!list_empty(&frame->sharers)){
+        struct stable_entry *entry = frame_first(frame);
+        uint32_t *pagedir = entry->vma->thread->pagedir;
+        frame_remove_sharer(entry);
+        pagedir_clear_page(pagedir, entry->vaddr);
+        pagedir_set_page(pagedir, entry->vaddr, into->kpage, false);
+        frame_add_sharer(into, entry);
+    }
+    frame_release(frame);
+    ksm_merge_cnt++;
+}
+
+/* Considers FRAME for merging.  Caller must hold frame_lock. */
+static void ksm_scan(struct frame_entry *frame){
+    if(frame->ksm != KSM_NONE || !ksm_is_mergeable(frame)){
+        return;
+    }
+    unsigned checksum = hash_bytes(frame->kpage, PGSIZE);
+    if(checksum != frame->checksum){
+        frame->checksum = checksum;
+        return;
+    }
+
+    ksm_protect(frame);
+    struct hash_elem *e = hash_find(&ksm_stable, &frame->ksm_elem);
+    if(e != NULL){
+        struct frame_entry *stable = hash_entry(e, struct frame_entry, ksm_elem);
+        if(!frame_is_pinned(stable)){
+            ksm_merge(frame, stable);
+        }
+        return;
+    }
+
+    e = hash_insert(&ksm_unstable, &frame->ksm_elem);
+    if(e == NULL){
+        frame->ksm = KSM_UNSTABLE;
+        return;
+    }
+    struct frame_entry *twin = hash_entry(e, struct frame_entry, ksm_elem);
+    if(!ksm_is_mergeable(twin)){
+        return;
+    }
+    ksm_protect(twin);
+    if(memcmp(twin->kpage, frame->kpage, PGSIZE) == 0){
+        hash_delete(&ksm_unstable, &twin->ksm_elem);
+        twin->ksm = KSM_STABLE;
+        hash_insert(&ksm_stable, &twin->ksm_elem);
+        ksm_merge(frame, twin);
+    }
+}
+
+/* Takes FRAME out of the merging tables, for a frame that is being
+   freed or may be written.  Caller must hold frame_lock. */
+static void ksm_forget(struct frame_entry *frame){
+    if(frame->ksm == KSM_STABLE){
+        hash_delete(&ksm_stable, &frame->ksm_elem);
+    }
+    else if(frame->ksm == KSM_UNSTABLE){
+        hash_delete(&ksm_unstable, &frame->ksm_elem);
+    }
+    frame->ksm = KSM_NONE;
+    frame->checksum = 0;
+}
+
+static unsigned ksm_stable_hash(const struct hash_elem *e, void *aux UNUSED){
+    return hash_entry(e, struct frame_entry, ksm_elem)->checksum;
+}
+
+static bool ksm_stable_less(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED){
+    return memcmp(hash_entry(a, struct frame_entry, ksm_elem)->kpage,
+                  hash_entry(b, struct frame_entry, ksm_elem)->kpage, PGSIZE) < 0;
+}
+
+static bool ksm_unstable_less(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED){
+    return hash_entry(a, struct frame_entry, ksm_elem)->checksum
+           < hash_entry(b, struct frame_entry, ksm_elem)->checksum;
+}
+
+/* Picks a frame to evict with the configured policy.  Frames in
+   4 MB pages are passed over; only if nothing else can be evicted
+   is one split into 4 kB pages and taken.  Returns NULL if every
+   frame is free or pinned.  Caller must hold frame_lock. */
+struct frame_entry * get_frame_eviction(){
+    struct frame_entry *victim = frame_policy->select();
+    if(victim != NULL){
+        return victim;
+    }
+    for(size_t i = 0; i < frame_cnt; i++){
+        struct frame_entry *frame = &frame_table[i];
+        if(!list_empty(&frame->sharers) && !frame_is_pinned(frame) && frame_is_large(frame)){
+            struct stable_entry *entry = frame_first(frame);
+            if(pagedir_demote(entry->vma->thread->pagedir, entry->vaddr)){
+                return frame;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Second-chance clock over the frame table.  The hand keeps its
+   position between calls, so each eviction only examines the
+   frames since the last victim instead of rescanning from the
+   start.  Two full sweeps always find a victim if there is one:
+   the first clears every accessed bit it passes. */
+static struct frame_entry *clock_select(void){
+    for(size_t i = 0; i < 2 * frame_cnt; i++){
+        struct frame_entry *frame = &frame_table[frame_hand];
+        frame_hand = (frame_hand + 1) % frame_cnt;
+        if(list_empty(&frame->sharers) || frame_is_pinned(frame) || frame_is_large(frame)){
+            continue;
+        }
+        if(frame_is_accessed(frame)){
+            continue;
+        }
+        return frame;
+    }
+    return NULL;
+}
+
+static void wsclock_insert(struct frame_entry *frame){
+    frame->last_use = timer_ticks();
+}
+
+/* WSClock.  The same hand as the clock, but a frame's age is the
+   time since its accessed bit was last seen set.  Prefers a clean
+   frame that has left the working set, since dropping it costs no
+   I/O, then a dirty one, and only then the least recently used
+   frame still in the working set. */
+static struct frame_entry *wsclock_select(void){
+    int64_t now = timer_ticks();
+    struct frame_entry *old_dirty = NULL;
+    struct frame_entry *oldest = NULL;
+    for(size_t i = 0; i < 2 * frame_cnt; i++){
+        struct frame_entry *frame = &frame_table[frame_hand];
+        frame_hand = (frame_hand + 1) % frame_cnt;
+        if(list_empty(&frame->sharers) || frame_is_pinned(frame) || frame_is_large(frame)){
+            continue;
+        }
+        if(frame_is_accessed(frame)){
+            frame->last_use = now;
+        }
+        else if(now - frame->last_use <= WSCLOCK_TAU){
+            if(oldest == NULL || frame->last_use < oldest->last_use){
+                oldest = frame;
+            }
+        }
+        else if(!frame_needs_write(frame)){
+            return frame;
+        }
+        else if(old_dirty == NULL){
+            old_dirty = frame;
+        }
+        /* A second sweep is only needed if every frame was
+           accessed during the first. */
+        if(i + 1 == frame_cnt && (old_dirty != NULL || oldest != NULL)){
+            break;
+        }
+    }
+    return old_dirty != NULL ? old_dirty : oldest;
+}
+
+static void twoq_insert(struct frame_entry *frame){
+    list_push_back(&twoq_a1, &frame->lru_elem);
+}
+
+static void twoq_remove(struct frame_entry *frame){
+    list_remove(&frame->lru_elem);
+}
+
+/* Looks for a victim in QUEUE, oldest first.  Referenced pages get
+   a second chance at the back of twoq_am.  A victim stays queued
+   until twoq_remove() runs when its frame is freed. */
+static struct frame_entry *twoq_scan(struct list *queue){
+    for(size_t n = list_size(queue); n > 0; n--){
+        struct frame_entry *frame = list_entry(list_pop_front(queue), struct frame_entry, lru_elem);
+        if(frame_is_pinned(frame) || frame_is_large(frame)){
+            list_push_back(queue, &frame->lru_elem);
+        }
+        else if(frame_is_accessed(frame)){
+            list_push_back(&twoq_am, &frame->lru_elem);
+        }
+        else{
+            list_push_back(queue, &frame->lru_elem);
+            return frame;
+        }
+    }
+    return NULL;
+}
+
+/* 2Q, a cheap approximation of LRU-2 that needs only accessed
+   bits.  Evicts from twoq_a1 while it holds more than its share
+   of frames, otherwise from twoq_am. */
+static struct frame_entry *twoq_select(void){
+    struct frame_entry *frame = NULL;
+    if(list_size(&twoq_a1) > frame_cnt / TWOQ_A1_SHARE || list_empty(&twoq_am)){
+        frame = twoq_scan(&twoq_a1);
+    }
+    if(frame == NULL){
+        frame = twoq_scan(&twoq_am);
+    }
+    if(frame == NULL){
+        frame = twoq_scan(&twoq_a1);
+    }
+    return frame;
+}
+
+/* Clock over the frames mapped by T alone, with T's own hand, for
+   evicting within T's resident set.  Returns NULL if T has no such
+   frame that is not pinned or in a large page.  Caller must hold
+   frame_lock. */
+static struct frame_entry *frame_pick_owned(struct thread *t){
+    for(size_t i = 0; i < 2 * frame_cnt; i++){
+        struct frame_entry *frame = &frame_table[t->rss_hand];
+        t->rss_hand = (t->rss_hand + 1) % frame_cnt;
+        if(list_empty(&frame->sharers) || frame_is_pinned(frame)
+           || frame_first(frame)->vma->thread != t
+           || list_begin(&frame->sharers) != list_rbegin(&frame->sharers)
+           || frame_is_large(frame)){
+            continue;
+        }
+        if(frame_is_accessed(frame)){
+            continue;
+        }
+        return frame;
+    }
+    return NULL;
+}
+
+/* Returns the first entry mapping FRAME.  Victim ordering and the
+   write-back decision use it; all sharers map the same data. */
+static struct stable_entry *frame_first(struct frame_entry *frame){
+    return list_entry(list_front(&frame->sharers), struct stable_entry, frame_elem);
+}
+
+/* Records that ENTRY maps FRAME.  Caller must hold frame_lock. */
+static void frame_add_sharer(struct frame_entry *frame, struct stable_entry *entry){
+    if(list_empty(&frame->sharers) && frame_policy->insert != NULL){
+        frame_policy->insert(frame);
+    }
+    list_push_back(&frame->sharers, &entry->frame_elem);
+    entry->frame = frame;
+    entry->is_loaded = true;
+    entry->vma->thread->rss++;
+}
+
+/* Records that ENTRY no longer maps its frame.  The caller updates
+   the rest of ENTRY.  Caller must hold frame_lock. */
+static void frame_remove_sharer(struct stable_entry *entry){
+    list_remove(&entry->frame_elem);
+    entry->vma->thread->rss--;
+}
+
+/* Frees FRAME, whose last sharer has gone.  Caller must hold
+   frame_lock. */
+static void frame_release(struct frame_entry *frame){
+    ASSERT(frame->io_pins == 0);
+    frame_uncache(frame);
+    ksm_forget(frame);
+    if(frame_policy->remove != NULL){
+        frame_policy->remove(frame);
+    }
+    palloc_free_page(frame->kpage);
+}
+
+/* Returns true if evicting FRAME would have to write it to its
+   file or to swap. */
+static bool frame_needs_write(struct frame_entry *frame){
+    struct stable_entry *entry = frame_first(frame);
+    if(entry->vma->file != NULL && entry->vma->mapid != -1){
+        return frame_is_dirty(frame);
+    }
+    return frame_sharer_dirty(frame) || frame_is_dirty(frame);
+}
+
+/* Returns true if any mapping of FRAME was accessed since the last
+   call, clearing the accessed bits as it goes. */
+static bool frame_is_accessed(struct frame_entry *frame){
+    bool accessed = false;
+    struct list_elem *e;
+    for(e = list_begin(&frame->sharers); e != list_end(&frame->sharers); e = list_next(e)){
+        struct stable_entry *entry = list_entry(e, struct stable_entry, frame_elem);
+        uint32_t *pagedir = entry->vma->thread->pagedir;
+        if(pagedir_is_accessed(pagedir, entry->vaddr)){
+            pagedir_set_accessed(pagedir, entry->vaddr, false);
+            /* A sequential pass is not expected to come back, so
+               its references do not keep the page resident. */
+            if(entry->vma->advice != MADV_SEQUENTIAL){
+                accessed = true;
+            }
+        }
+    }
+    return accessed;
+}
+
+/* Returns true if FRAME is part of a 4 MB page.  Large pages are
+   only used for private memory, so they have a single sharer. */
+static bool frame_is_large(struct frame_entry *frame){
+    struct stable_entry *entry = frame_first(frame);
+    return pagedir_is_large(entry->vma->thread->pagedir, entry->vaddr);
+}
+
+/* Returns true if any entry sharing FRAME is marked dirty.  Same
+   page merging gathers the entries of clean and modified copies
+   onto one frame, so the first sharer alone does not tell. */
+static bool frame_sharer_dirty(struct frame_entry *frame){
+    struct list_elem *e;
+    for(e = list_begin(&frame->sharers); e != list_end(&frame->sharers); e = list_next(e)){
+        if(list_entry(e, struct stable_entry, frame_elem)->dirty){
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Returns true if FRAME was written through any of its mappings. */
+static bool frame_is_dirty(struct frame_entry *frame){
+    struct list_elem *e;
+    for(e = list_begin(&frame->sharers); e != list_end(&frame->sharers); e = list_next(e)){
+        struct stable_entry *entry = list_entry(e, struct stable_entry, frame_elem);
+        if(pagedir_is_dirty(entry->vma->thread->pagedir, entry->vaddr)){
+            return true;
+        }
+    }
+    return false;
+}
+
+static struct frame_entry *frame_lookup(void *kpage){
+    size_t index = ((uint8_t *) kpage - frame_base) / PGSIZE;
+    ASSERT(index < frame_cnt);
+    return &frame_table[index];
+}
+
+/* Only read-only pages loaded from an executable are cached.  The
+   executable cannot be written while it runs, so its pages never
+   go stale. */
+static bool frame_is_cacheable(struct stable_entry *entry){
+    return entry->vma->file != NULL && entry->vma->mapid == -1 && !entry->vma->writable
+           && stable_page_read_bytes(entry) > 0;
+}
+
+/* Returns the cached frame holding ENTRY's page, or NULL.  Caller
+   must hold frame_lock. */
+static struct frame_entry *frame_cache_find(struct stable_entry *entry){
+    struct frame_entry key;
+    key.inode = file_get_inode(entry->vma->file);
+    key.offset = stable_page_offset(entry);
+    key.read_bytes = stable_page_read_bytes(entry);
+    struct hash_elem *e = hash_find(&frame_cache, &key.cache_elem);
+    return e != NULL ? hash_entry(e, struct frame_entry, cache_elem) : NULL;
+}
+
+/* Removes FRAME from the text page cache, if it is there.  Caller
+   must hold frame_lock. */
+static void frame_uncache(struct frame_entry *frame){
+    if(frame->cached){
+        hash_delete(&frame_cache, &frame->cache_elem);
+        frame->cached = false;
+    }
+}
+
+static unsigned frame_cache_hash(const struct hash_elem *e, void *aux UNUSED){
+    const struct frame_entry *frame = hash_entry(e, struct frame_entry, cache_elem);
+    return hash_bytes(&frame->inode, sizeof frame->inode) ^ hash_int(frame->offset);
+}
+
+static bool frame_cache_less(const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED){
+    const struct frame_entry *x = hash_entry(a, struct frame_entry, cache_elem);
+    const struct frame_entry *y = hash_entry(b, struct frame_entry, cache_elem);
+    if(x->inode != y->inode){
+        return (uintptr_t) x->inode < (uintptr_t) y->inode;
+    }
+    if(x->offset != y->offset){
+        return x->offset < y->offset;
+    }
+    return x->read_bytes < y->read_bytes;
+}
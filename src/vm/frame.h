@@ -2,21 +2,61 @@
 #define VM_FRAME_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
 #include "threads/palloc.h"
+#include "filesys/off_t.h"
+
+struct stable_entry;
+
+/* One entry per user pool frame.  The frame table is an array
+   indexed by the frame's page number within the user pool, so a
+   kpage maps to its entry without searching.  A frame is normally
+   mapped by one stable_entry, but after fork several processes'
+   entries may share it copy-on-write, and read-only executable
+   pages are shared by every process running the same program.  A
+   slot with no sharers is not holding a user page. */
+enum frame_ksm {
+    KSM_NONE,       // not in a same-page merging table
+    KSM_UNSTABLE,   // in ksm_unstable, keyed by checksum
+    KSM_STABLE      // in ksm_stable, keyed by contents; read-only
+};
 
 struct frame_entry {
-    struct thread * thread;
-    struct list_elem elem;
-    void* user_addr;
     void* kpage;
-    struct stable_entry* entry;
+    struct list sharers;    // stable_entry.frame_elem of every mapping
+    bool pinned;    // being evicted, not a candidate
+    unsigned io_pins;   // frame_pin() calls not yet undone
+    bool cached;    // in the text page cache under the key below
+    struct hash_elem cache_elem;
+    struct inode *inode;
+    off_t offset;
+    size_t read_bytes;
+    int64_t last_use;       // WSClock: ticks when last seen accessed
+    struct list_elem lru_elem;  // 2Q: element in a queue
+    unsigned checksum;      // KSM: contents hash when last scanned
+    enum frame_ksm ksm;
+    struct hash_elem ksm_elem;
 };
-void frame_init();
+void frame_init(size_t low_water, size_t rss_limit, const char *policy);
+void frame_pageout_init(void);
+void frame_ksm_init(size_t batch);
 void frame_allocate(struct stable_entry* entry, void *kpage);
-void frame_deallocate(void * user_adder);
-void frame_thread_remove(struct thread* t);
-struct frame_entry * get_frame_eviction();
+bool frame_map_cached(struct stable_entry *entry);
+bool frame_deallocate(struct stable_entry *entry);
+bool frame_fork(struct stable_entry *parent, struct stable_entry *child);
+void frame_unshare(struct stable_entry *entry);
+bool frame_pin(struct stable_entry *entry);
+void frame_unpin(struct frame_entry *frame);
+bool frame_io_pinned(struct stable_entry *entry);
+void frame_wait_evicted(struct stable_entry *entry);
+struct frame_entry * get_frame_eviction(void);
 void * frame_kpage(enum palloc_flags flags);
+void * frame_kpage_try(enum palloc_flags flags);
+void * frame_kpage_large(void);
+void * frame_kpage_run(size_t cnt);
+void * frame_zero_page(void);
+size_t frame_rss_limit(struct thread *t);
+void frame_print_stats(void);
 
-#endif
\ No newline at end of file
+#endif
@@ -1,229 +1,777 @@
+#include <string.h>
+#include <round.h>
 #include "vm/page.h"
 #include "vm/frame.h"
+#include "vm/swap.h"
+#include "vm/vmstat.h"
+#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/palloc.h"
+#include "threads/pte.h"
+#include "userprog/pagedir.h"
 #include "userprog/process.h"
 #include "threads/interrupt.h"
 
-bool stable_less(struct hash_elem *a, struct hash_elem *b, void *aux);
-size_t stable_hash_hash(struct hash_elem *a, void *aux);
-struct stable_entry* stable_stack_element(void* addr);
-void stable_free_elem(struct hash_elem *elem, void *aux);
-void stable_mapping_free(struct hash_elem *elem, void* aux);
-void stable_remove_thread(struct stable_entry *entry);
+static struct vma *stable_vma_alloc(void *base, void *start, void *end, struct file *file, off_t offset, size_t read_bytes, bool writable, mapid_t mapid);
+static void stable_unmap(struct vma *vma);
+static bool stable_free(struct stable_entry *entry);
+static struct stable_entry *stable_vma_entry(struct vma *vma, void *addr, bool create);
+static struct vma *stable_find_mapping(mapid_t mapping);
+static void stable_sync(struct vma *vma, uint8_t *start, uint8_t *end);
+static void stable_swap_readahead(struct thread *t, struct stable_entry *entry, size_t swap_index);
+static bool stable_load_file(struct stable_entry *entry, uint8_t *kpage);
+static void stable_fault_around(struct thread *t, struct stable_entry *entry);
+static bool stable_map_large(struct thread *t, struct stable_entry *entry);
+static bool stable_is_large_candidate(struct stable_entry *entry);
 
-void stable_init(struct hash *table){
-    hash_init(table, &stable_hash_hash, &stable_less, NULL);
-}
+#define SWAP_READAHEAD 4 // swapped neighbours read along with a faulting page
+#define FAULT_AROUND_MIN 1  // file pages mapped ahead of a random fault
+#define FAULT_AROUND_MAX 16 // ... and of a long run of sequential faults
+#define STACK_LIMIT 2048    // default largest stack, in pages
+#define STACK_GROW 8        // default pages the stack grows by per fault
+#define POPULATE_RUN 16     // file pages read per request by stable_populate()
+#define SYNC_RUN 16         // most dirty pages stable_sync() pins for one write
+
+/* Areas and page entry chunks come from their own caches. */
+static struct slab_cache vma_cache;
+static struct slab_cache chunk_cache;
 
-static bool
-install_page(void *upage, void *kpage, bool writable)
-{
-  struct thread *t = thread_current();
+static size_t stack_limit;  // largest stack of a new process, in pages
+static size_t stack_grow;   // pages the stack grows by per fault
 
-  /* Verify that there's not already a page at that virtual
-     address, then map our page there. */
-  return (pagedir_get_page(t->pagedir, upage) == NULL && pagedir_set_page(t->pagedir, upage, kpage, writable));
+/* Must run after malloc_init().  LIMIT and GROW set the largest
+   stack of each process and how many pages it grows by at a time;
+   0 selects the default. */
+void stable_boot_init(size_t limit, size_t grow){
+    slab_cache_init(&vma_cache, "vma", sizeof(struct vma));
+    slab_cache_init(&chunk_cache, "stable_chunk", sizeof(struct stable_chunk));
+    stack_limit = limit != 0 ? limit : STACK_LIMIT;
+    if(stack_limit > (size_t) PHYS_BASE / PGSIZE / 2){
+        stack_limit = (size_t) PHYS_BASE / PGSIZE / 2;
+    }
+    stack_grow = grow != 0 ? grow : STACK_GROW;
 }
 
- 
+void stable_init(struct vma_tree *tree){
+    vma_tree_init(tree);
+}
+
+/* Grows the stack down to ADDR and faults in its page.  The stack
+   is one area whose start moves down.  Its lowest page is a guard
+   page that is never mapped, and it never comes within a page of
+   another area, so an overflow faults instead of running into
+   other memory.  The area spans stack_limit pages when fully grown,
+   a limit fixed for the process when the first call creates it.
+   The stack grows by at least stack_grow pages at a time, and the
+   new pages are mapped while frames are free, so a deep recursion
+   takes one fault per chunk instead of one per page. */
 bool stable_stack_alloc(void *addr){
-    void *sp;
-    struct stable_entry *entry;
-    uint8_t *kpage;
-    bool success = false;
-    if(PHYS_BASE - 2048 * PGSIZE <= addr && addr < PHYS_BASE){
-        //printf("stack alloc\n");
-        for(sp = PHYS_BASE - PGSIZE; sp >= pg_round_down(addr); sp -= PGSIZE){
-            struct thread *t = thread_current();
-            if(stable_is_exist(t, sp)){
-                continue;
-            }
-            entry = stable_stack_element(sp);
-            kpage = frame_kpage(PAL_USER);
-            if (kpage != NULL)
-            {
-                success = install_page(sp, kpage, true);
-                if(!success)
-                {
-                    palloc_free_page(kpage);
-                    stable_free(entry);
-                    return false;
-                }
-                return success;
-            }
+    struct thread *t = thread_current();
+    uint8_t *page = pg_round_down(addr);
+    struct vma *stack = vma_find(&t->stable, (uint8_t *) PHYS_BASE - PGSIZE);
+    if(!is_user_vaddr(addr)){
+        return false;
+    }
+    if(stack == NULL){
+        uint8_t *base = (uint8_t *) PHYS_BASE - stack_limit * PGSIZE;
+        if(page <= base){
+            return false;
+        }
+        stack = stable_vma_alloc(base, page, PHYS_BASE, NULL, 0, 0, true, -2);
+        if(stack == NULL){
+            return false;
+        }
+        if(!vma_insert(&t->stable, stack)){
+            stable_unmap(stack);
+            return false;
         }
-        return success;
+        return stable_frame_alloc(page, true);
     }
-    else{
+    if(stack->mapid != -2 || page <= (uint8_t *) stack->base){
+        return false;
+    }
+    if(page >= (uint8_t *) stack->start){
+        return stable_frame_alloc(page, true);
+    }
+    if(vma_overlap(&t->stable, page - PGSIZE, stack->start) != NULL){
         return false;
     }
+
+    /* Grow by a whole chunk if that leaves the guard pages free. */
+    uint8_t *old = stack->start;
+    uint8_t *start = page;
+    if((size_t) (old - page) / PGSIZE < stack_grow){
+        size_t room = (old - (uint8_t *) stack->base) / PGSIZE - 1;
+        start = old - (stack_grow < room ? stack_grow : room) * PGSIZE;
+        if(start > page || vma_overlap(&t->stable, start - PGSIZE, page) != NULL){
+            start = page;
+        }
+    }
+    stack->start = start;
+    if(!stable_frame_alloc(page, true)){
+        stack->start = old;
+        return false;
+    }
+    for(uint8_t *upage = old - PGSIZE; upage >= start; upage -= PGSIZE){
+        struct stable_entry *entry = stable_find_entry(t, upage);
+        if(upage == page){
+            continue;
+        }
+        uint8_t *kpage = entry != NULL ? frame_kpage_try(PAL_ZERO) : NULL;
+        if(kpage == NULL){
+            break;
+        }
+        if(!pagedir_set_page(t->pagedir, upage, kpage, true)){
+            palloc_free_page(kpage);
+            break;
+        }
+        frame_allocate(entry, kpage);
+    }
+    return true;
 }
 
-struct stable_entry* stable_stack_element(void* addr){
-    struct stable_entry *entry = malloc(sizeof(struct stable_entry));
-    entry->vaddr = pg_round_down(addr);
-    entry->offset = addr - entry->vaddr;
-    entry->file = NULL;
-    entry->read_bytes = PGSIZE;
-    entry->is_loaded = true;
-    entry->zero_bytes = 0;
-    entry->writable = true;
-    entry->mapid = -2;
-    entry->swap_index = -1;
-    hash_insert(&thread_current()->stable, &entry->elem);
-    return entry;
-}
-
-struct stable_entry* stable_alloc(void* addr, struct file* file, size_t offset, size_t read_bytes, bool writable, mapid_t mapid){
-    struct stable_entry *entry = malloc(sizeof(struct stable_entry));
-    entry->vaddr = pg_round_down(addr);
-    entry->offset = offset;
-    entry->file = file_reopen(file);
-    file_seek(entry->file, offset);
-    entry->read_bytes = read_bytes;
-    entry->is_loaded = false;
-    entry->zero_bytes = PGSIZE - read_bytes;
-    entry->writable = writable; 
-    entry->mapid = mapid;
-    entry->swap_index = -1;
-    hash_insert(&thread_current()->stable, &entry->elem);
-    return entry;
+/* Creates an area of PAGE_CNT pages at UPAGE in the current
+   process.  The first READ_BYTES bytes come from FILE at OFFSET,
+   which is reopened so the area outlives the caller's handle, and
+   the rest is zero filled.  Returns NULL if the pages are not all
+   free user pages or memory runs out. */
+struct vma *stable_map(void *upage, size_t page_cnt, struct file *file, off_t offset, size_t read_bytes, bool writable, mapid_t mapid){
+    struct thread *t = thread_current();
+    uint8_t *end = (uint8_t *) upage + page_cnt * PGSIZE;
+    if(page_cnt == 0 || pg_ofs(upage) != 0 || end <= (uint8_t *) upage || end > (uint8_t *) PHYS_BASE){
+        return NULL;
+    }
+    struct vma *vma = stable_vma_alloc(upage, upage, end, file, offset, read_bytes, writable, mapid);
+    if(vma == NULL){
+        return NULL;
+    }
+    if(!vma_insert(&t->stable, vma)){
+        stable_unmap(vma);
+        return NULL;
+    }
+    return vma;
+}
+
+/* Allocates an area of the current process covering [START, END),
+   whose page entries may later cover [BASE, END).  Does not add it
+   to the tree. */
+static struct vma *stable_vma_alloc(void *base, void *start, void *end, struct file *file, off_t offset, size_t read_bytes, bool writable, mapid_t mapid){
+    struct vma *vma = slab_alloc(&vma_cache);
+    if(vma == NULL){
+        return NULL;
+    }
+    vma->base = base;
+    vma->start = start;
+    vma->end = end;
+    vma->offset = offset;
+    vma->read_bytes = read_bytes;
+    vma->writable = writable;
+    vma->mapid = mapid;
+    vma->advice = MADV_NORMAL;
+    vma->thread = thread_current();
+    vma->chunk_cnt = DIV_ROUND_UP(((uint8_t *) end - (uint8_t *) base) / PGSIZE, STABLE_CHUNK_PAGES);
+    vma->chunks = calloc(vma->chunk_cnt, sizeof *vma->chunks);
+    vma->file = file != NULL ? file_reopen(file) : NULL;
+    if(vma->chunks == NULL || (file != NULL && vma->file == NULL)){
+        file_close(vma->file);
+        free(vma->chunks);
+        slab_free(&vma_cache, vma);
+        return NULL;
+    }
+    return vma;
 }
 
 /* When Page fault exceptin, check valid address and allocate frame.
+   A read of a zero-fill page maps the shared zero frame; a real
+   frame is allocated only when the page is first written.
  */
-bool stable_frame_alloc(void* addr){
+bool stable_frame_alloc(void* addr, bool write){
     struct thread *t = thread_current();
     struct stable_entry *entry = stable_find_entry(t, addr);
     
     if(entry == NULL){
         return false;
     }
+    frame_wait_evicted(entry);
     if(entry->is_loaded){
         return true;
     }
 
     enum palloc_flags flags = PAL_USER;
+    size_t read_bytes = stable_page_read_bytes(entry);
     uint8_t *kpage;
     int swap_index = entry->swap_index;
+    bool from_file = false;
 
     if(swap_index >= 0){
         kpage = frame_kpage(flags);
 
-        if(!pagedir_set_page(t->pagedir, pg_round_down(addr), kpage, entry->writable)){
+        if(!pagedir_set_page(t->pagedir, pg_round_down(addr), kpage, entry->vma->writable)){
             palloc_free_page(kpage);
             return false;
         }
 
         swap_in(entry->swap_index, kpage);
+        stable_swap_readahead(t, entry, entry->swap_index);
         entry->swap_index = -1;
     }
+    else if(read_bytes == 0 && stable_map_large(t, entry)){
+        return true;
+    }
+    else if(read_bytes == 0 && !write){
+        if(!pagedir_set_page(t->pagedir, entry->vaddr, frame_zero_page(), false)){
+            return false;
+        }
+        entry->zero = true;
+        entry->is_loaded = true;
+        return true;
+    }
+    else if(frame_map_cached(entry)){
+        stable_fault_around(t, entry);
+        return true;
+    }
     else{
-        if(entry->read_bytes == 0){
+        if(read_bytes == 0){
             flags |= PAL_ZERO;
         }
 
         kpage = frame_kpage(flags);
 
-        if(entry->read_bytes > 0){
-            if(file_read_at(entry->file, kpage, entry->read_bytes, entry->offset) != (int) entry->read_bytes){
+        if(read_bytes > 0){
+            if(!stable_load_file(entry, kpage)){
                 palloc_free_page(kpage);
                 return false;
             }
-            memset(kpage + entry->read_bytes, 0, entry->zero_bytes);
+            from_file = true;
         }
 
-        if(!pagedir_set_page(t->pagedir, pg_round_down(addr), kpage, entry->writable)){
+        if(!pagedir_set_page(t->pagedir, pg_round_down(addr), kpage, entry->vma->writable)){
             palloc_free_page(kpage);
             return false;
         }
     }
+    pagedir_set_dirty(t->pagedir, pg_round_down(addr), false);
     frame_allocate(entry, kpage);
-    pagedir_set_dirty(t->pagedir, kpage, false);
-    entry->is_loaded = true;
+    if(from_file){
+        stable_fault_around(t, entry);
+    }
     return true;    
 }
 
-/*  Find stable entry by user address. If invalid, return NULL
+/* Faults in the pages of VMA in [START, END) now, for
+   mmap_populate() and MADV_WILLNEED.  File
+   pages are read POPULATE_RUN at a time into physically contiguous
+   frames, with one read per run instead of one per page fault.
+   Pages that are already present, or for which no run of free
+   frames is available, are faulted in one at a time as usual. */
+void stable_populate(struct vma *vma, uint8_t *start, uint8_t *end){
+    struct thread *t = thread_current();
+    uint8_t *upage = start;
+
+    while(upage < end){
+        /* Find the run of file pages not yet in memory at UPAGE. */
+        size_t cnt = 0;
+        while(cnt < POPULATE_RUN && upage + cnt * PGSIZE < end){
+            struct stable_entry *entry = stable_find_entry(t, upage + cnt * PGSIZE);
+            if(entry == NULL || entry->is_loaded || (int) entry->swap_index != -1
+               || entry->dirty || stable_page_read_bytes(entry) == 0){
+                break;
+            }
+            cnt++;
+        }
+
+        uint8_t *kpage = cnt > 1 ? frame_kpage_run(cnt) : NULL;
+        if(kpage == NULL){
+            if(!stable_frame_alloc(upage, false)){
+                return;
+            }
+            upage += PGSIZE;
+            continue;
+        }
+
+        struct stable_entry *first = stable_find_entry(t, upage);
+        size_t read_bytes = vma->read_bytes - (upage - (uint8_t *) vma->base);
+        if(read_bytes > cnt * PGSIZE){
+            read_bytes = cnt * PGSIZE;
+        }
+        if(file_read_at(vma->file, kpage, read_bytes, stable_page_offset(first)) != (int) read_bytes){
+            palloc_free_multiple(kpage, cnt);
+            return;
+        }
+        memset(kpage + read_bytes, 0, cnt * PGSIZE - read_bytes);
+
+        for(size_t i = 0; i < cnt; i++, upage += PGSIZE){
+            if(!pagedir_set_page(t->pagedir, upage, kpage + i * PGSIZE, vma->writable)){
+                palloc_free_multiple(kpage + i * PGSIZE, cnt - i);
+                return;
+            }
+            pagedir_set_dirty(t->pagedir, upage, false);
+            frame_allocate(stable_find_entry(t, upage), kpage + i * PGSIZE);
+        }
+    }
+}
+
+/* Backs the whole 4 MB aligned region around ENTRY with one large
+   page, if every page in the region is an untouched anonymous page
+   and enough aligned frames are free.  This saves 1023 faults and
+   a page table, and the region takes one TLB entry.  Returns false
+   otherwise; the caller then maps a 4 kB page as usual. */
+static bool stable_map_large(struct thread *t, struct stable_entry *entry){
+    uint8_t *base = (uint8_t *) ((uintptr_t) entry->vaddr & ~(uintptr_t) (LARGE_PAGE_SIZE - 1));
+    size_t i;
+
+    /* Cheap checks first: once any page of the region is mapped
+       there is a page table and this fails right away. */
+    if(base < (uint8_t *) entry->vma->start
+       || base + LARGE_PAGE_SIZE > (uint8_t *) entry->vma->end
+       || !pagedir_is_region_empty(t->pagedir, base)
+       || palloc_user_free_cnt() < LARGE_PAGE_CNT){
+        return false;
+    }
+    for(i = 0; i < LARGE_PAGE_CNT; i++){
+        if(!stable_is_large_candidate(stable_find_entry(t, base + i * PGSIZE))){
+            return false;
+        }
+    }
+
+    uint8_t *kpage = frame_kpage_large();
+    if(kpage == NULL){
+        return false;
+    }
+    if(!pagedir_set_large_page(t->pagedir, base, kpage, true)){
+        palloc_free_multiple(kpage, LARGE_PAGE_CNT);
+        return false;
+    }
+    for(i = 0; i < LARGE_PAGE_CNT; i++){
+        frame_allocate(stable_find_entry(t, base + i * PGSIZE), kpage + i * PGSIZE);
+    }
+    return true;
+}
+
+/* A page can go in a large page if it is private, writable, zero
+   filled and not in memory or swap yet. */
+static bool stable_is_large_candidate(struct stable_entry *entry){
+    return entry != NULL && stable_page_read_bytes(entry) == 0 && entry->vma->writable
+           && entry->vma->mapid < 0 && !entry->is_loaded
+           && (int) entry->swap_index == -1 && !entry->dirty;
+}
+
+/* Reads ENTRY's page from its file into KPAGE and zeroes the rest. */
+static bool stable_load_file(struct stable_entry *entry, uint8_t *kpage){
+    size_t read_bytes = stable_page_read_bytes(entry);
+    vmstat_major();
+    if(file_read_at(entry->vma->file, kpage, read_bytes, stable_page_offset(entry)) != (int) read_bytes){
+        return false;
+    }
+    memset(kpage + read_bytes, 0, PGSIZE - read_bytes);
+    return true;
+}
+
+/* Fault-around for file-backed pages.  After ENTRY has been read
+   in, also map the pages that follow it in the same area.  The
+   window starts small and doubles each time a fault lands right
+   after the previous window, so sequential scans of code or mmaps
+   take few faults while random access reads little extra.
+   MADV_SEQUENTIAL areas always use the largest window and
+   MADV_RANDOM areas none.  Pages in the text page cache are mapped
+   without I/O; others only use free frames. */
+static void stable_fault_around(struct thread *t, struct stable_entry *entry){
+    size_t window = FAULT_AROUND_MIN;
+    if(entry->vma->advice == MADV_RANDOM){
+        return;
+    }
+    if(entry->vma->advice == MADV_SEQUENTIAL){
+        window = FAULT_AROUND_MAX;
+    }
+    else if(entry->vaddr == t->fault_next && t->fault_window >= FAULT_AROUND_MIN){
+        window = t->fault_window * 2;
+        if(window > FAULT_AROUND_MAX){
+            window = FAULT_AROUND_MAX;
+        }
+    }
+    t->fault_window = window;
+
+    size_t i;
+    for(i = 1; i <= window; i++){
+        struct stable_entry *next = stable_find_entry(t, entry->vaddr + i * PGSIZE);
+        if(next == NULL || next->vma != entry->vma || next->is_loaded
+           || (int) next->swap_index != -1 || next->dirty || stable_page_read_bytes(next) == 0){
+            break;
+        }
+        if(frame_map_cached(next)){
+            continue;
+        }
+        uint8_t *kpage = frame_kpage_try(0);
+        if(kpage == NULL){
+            break;
+        }
+        if(!stable_load_file(next, kpage) || !pagedir_set_page(t->pagedir, next->vaddr, kpage, next->vma->writable)){
+            palloc_free_page(kpage);
+            break;
+        }
+        frame_allocate(next, kpage);
+    }
+    t->fault_next = entry->vaddr + i * PGSIZE;
+}
+
+/* Swap readahead.  Eviction writes a process's neighbouring pages
+   to consecutive swap slots, so the pages that follow ENTRY in
+   memory are often in the slots that follow SWAP_INDEX.  Read
+   those in as well, but only while frames are free. */
+static void stable_swap_readahead(struct thread *t, struct stable_entry *entry, size_t swap_index){
+    if(entry->vma->advice == MADV_RANDOM){
+        return;
+    }
+    for(size_t i = 1; i <= SWAP_READAHEAD; i++){
+        struct stable_entry *next = stable_find_entry(t, entry->vaddr + i * PGSIZE);
+        if(next == NULL || next->is_loaded || next->swap_index != swap_index + i){
+            return;
+        }
+        uint8_t *kpage = frame_kpage_try(0);
+        if(kpage == NULL){
+            return;
+        }
+        if(!pagedir_set_page(t->pagedir, next->vaddr, kpage, next->vma->writable)){
+            palloc_free_page(kpage);
+            return;
+        }
+        swap_in(next->swap_index, kpage);
+        next->swap_index = -1;
+        frame_allocate(next, kpage);
+    }
+}
+
+/*  Find stable entry by user address. If invalid, return NULL.
 */
 struct stable_entry* stable_find_entry(struct thread *t, void* addr){
-    struct stable_entry entry;
-    entry.vaddr = pg_round_down(addr);
-    struct hash_elem *elem = hash_find(&t->stable, &entry.elem);
-    if(elem != NULL){
-        return hash_entry(elem, struct stable_entry, elem);
+    struct vma *vma = vma_find(&t->stable, addr);
+    if(vma == NULL){
+        return NULL;
     }
-    return NULL;
+    return stable_vma_entry(vma, addr, true);
 }
 
-bool stable_is_exist(struct thread* t, void *addr){
-    struct stable_entry entry;
-    entry.vaddr = pg_round_down(addr);
-    if( hash_find(&t->stable, &entry.elem) != NULL){
-        return true;
+/* Returns the entry for the page of VMA at ADDR.  If its chunk has
+   not been used yet, allocates it if CREATE is true and otherwise
+   returns NULL: such a page was never touched. */
+static struct stable_entry *stable_vma_entry(struct vma *vma, void *addr, bool create){
+    size_t page = ((uint8_t *) pg_round_down(addr) - (uint8_t *) vma->base) / PGSIZE;
+    struct stable_chunk *chunk = vma->chunks[page / STABLE_CHUNK_PAGES];
+    if(chunk == NULL){
+        if(!create){
+            return NULL;
+        }
+        chunk = slab_alloc(&chunk_cache);
+        if(chunk == NULL){
+            return NULL;
+        }
+        uint8_t *vaddr = (uint8_t *) vma->base + (page - page % STABLE_CHUNK_PAGES) * PGSIZE;
+        for(size_t i = 0; i < STABLE_CHUNK_PAGES; i++){
+            struct stable_entry *entry = &chunk->pages[i];
+            entry->vma = vma;
+            entry->vaddr = vaddr + i * PGSIZE;
+            entry->frame = NULL;
+            entry->swap_index = -1;
+            entry->is_loaded = false;
+            entry->dirty = false;
+            entry->cow = false;
+            entry->zero = false;
+        }
+        vma->chunks[page / STABLE_CHUNK_PAGES] = chunk;
     }
-    return false;
+    return &chunk->pages[page % STABLE_CHUNK_PAGES];
 }
 
-void stable_munmap(mapid_t mapping){
-    struct hash *table = &thread_current()->stable;
-    struct hash_iterator *i;
-    hash_first(&i, table);
-    struct hash_elem *elem;
-    struct stable_entry *entry;
-    table->aux = mapping;    
-    hash_apply(table, &stable_mapping_free);
-    table->aux = NULL;    
+bool stable_is_exist(struct thread* t, void *addr){
+    return vma_find(&t->stable, addr) != NULL;
 }
 
-void stable_mapping_free(struct hash_elem *elem, void* aux){
-    struct stable_entry *entry = hash_entry(elem, struct stable_entry, elem);
-    if(entry->mapid == aux){
-        stable_free(entry);
+void stable_munmap(mapid_t mapping){
+    struct vma *vma = stable_find_mapping(mapping);
+    if(vma != NULL){
+        stable_unmap(vma);
     }
 }
 
-void stable_free(struct stable_entry *entry){
-    void * addr = pg_round_down(entry->vaddr);
-    stable_write_back(entry);
-    file_close(entry->file);
-    if(entry->is_loaded);{
-        frame_deallocate(addr);
+/* Returns the current process's mmap MAPPING, or NULL.  Areas are
+   indexed by address, so this walks them in order. */
+static struct vma *stable_find_mapping(mapid_t mapping){
+    struct vma_tree *tree = &thread_current()->stable;
+    if(mapping < 0){
+        return NULL;
+    }
+    for(struct vma *vma = vma_first(tree); vma != NULL; vma = vma_next(tree, vma)){
+        if(vma->mapid == mapping){
+            return vma;
+        }
     }
-    hash_delete(&thread_current()->stable, &entry->elem);
-    free(entry);
+    return NULL;
+}
 
+/* Writes back the dirty pages of mmap MAPPING from OFFSET for
+   LENGTH bytes, or to its end if LENGTH is 0.  Returns false if
+   there is no such mapping. */
+bool stable_msync(mapid_t mapping, size_t offset, size_t length){
+    struct vma *vma = stable_find_mapping(mapping);
+    if(vma == NULL){
+        return false;
+    }
+    size_t size = (uint8_t *) vma->end - (uint8_t *) vma->start;
+    if(offset >= size){
+        return true;
+    }
+    if(length == 0 || length > size - offset){
+        length = size - offset;
+    }
+    uint8_t *start = pg_round_down((uint8_t *) vma->start + offset);
+    stable_sync(vma, start, pg_round_up((uint8_t *) vma->start + offset + length));
+    return true;
 }
 
-void stable_write_back(struct stable_entry *entry){
-    void * addr = pg_round_down(entry->vaddr);
-    if(entry != NULL && entry-> is_loaded && entry->file != NULL && entry->mapid != -1){
-        if(pagedir_is_dirty(thread_current()->pagedir, addr)){
-            file_write_at(entry->file, addr, entry->read_bytes, entry->offset);
-            pagedir_set_dirty (thread_current()->pagedir,  addr, false);
+/* Applies madvise() ADVICE to the pages in [ADDR, ADDR + LENGTH).
+   Access pattern hints apply to every area the range touches, as
+   a whole.  Returns false for an unknown hint. */
+bool stable_madvise(void *addr, size_t length, int advice){
+    struct vma_tree *tree = &thread_current()->stable;
+    uint8_t *start = pg_round_down(addr);
+    uint8_t *end = pg_round_up((uint8_t *) addr + length);
+    struct vma *vma, *next;
+    bool success = true;
+
+    if(advice < MADV_NORMAL || advice > MADV_DONTNEED || end < start){
+        return false;
+    }
+    for(vma = vma_lower_bound(tree, start); vma != NULL && (uint8_t *) vma->start < end; vma = next){
+        uint8_t *from = start > (uint8_t *) vma->start ? start : vma->start;
+        uint8_t *to = end < (uint8_t *) vma->end ? end : vma->end;
+        next = vma_next(tree, vma);
+        switch(advice){
+        case MADV_WILLNEED:
+            stable_populate(vma, from, to);
+            break;
+        case MADV_DONTNEED:
+            /* Dropped pages come back from the file, or as zeros.
+               Pages pinned for I/O, such as an aio ring, stay. */
+            stable_sync(vma, from, to);
+            for(uint8_t *upage = from; upage < to; upage += PGSIZE){
+                struct stable_entry *entry = stable_vma_entry(vma, upage, false);
+                if(entry != NULL && !frame_io_pinned(entry) && !stable_free(entry)){
+                    success = false;
+                }
+            }
+            break;
+        default:
+            vma->advice = advice;
+            break;
         }
     }
+    return success;
 }
 
-void stable_exit(struct hash *hash){
-    hash_destroy(hash, &stable_free_elem);
-    frame_thread_remove(thread_current());
+/* Writes back, unmaps and frees every page of VMA, then VMA
+   itself, removing it from its tree if it is there.  Large pages
+   lie wholly inside VMA, so they are unmapped whole up front
+   instead of being split, and no page can fail to be freed. */
+static void stable_unmap(struct vma *vma){
+    uint32_t *pagedir = vma->thread->pagedir;
+    stable_sync(vma, vma->start, vma->end);
+    for(uint8_t *region = (uint8_t *) ROUND_UP((uintptr_t) vma->start, LARGE_PAGE_SIZE);
+        region < (uint8_t *) vma->end; region += LARGE_PAGE_SIZE){
+        pagedir_unmap_large(pagedir, region);
+    }
+    for(size_t i = 0; i < vma->chunk_cnt; i++){
+        struct stable_chunk *chunk = vma->chunks[i];
+        if(chunk == NULL){
+            continue;
+        }
+        for(size_t j = 0; j < STABLE_CHUNK_PAGES; j++){
+            stable_free(&chunk->pages[j]);
+        }
+        slab_free(&chunk_cache, chunk);
+    }
+    if(vma_find(&vma->thread->stable, vma->start) == vma){
+        vma_remove(&vma->thread->stable, vma);
+    }
+    file_close(vma->file);
+    free(vma->chunks);
+    slab_free(&vma_cache, vma);
 }
 
-void stable_free_elem(struct hash_elem *elem, void *aux){
-    struct stable_entry* entry = hash_entry(elem, struct stable_entry, elem);
-    stable_write_back(entry);
+/* Unmaps ENTRY's page and frees its frame or swap slot.  The page
+   reads as it did before it was first touched afterwards.  Returns
+   false, freeing nothing, if ENTRY's large page cannot be split. */
+static bool stable_free(struct stable_entry *entry){
+    if(!frame_deallocate(entry)){
+        return false;
+    }
     swap_free(entry->swap_index);
-    file_close(entry->file);
-    free(entry);
+    entry->swap_index = -1;
+    entry->dirty = false;
+    return true;
 }
 
+/* Writes the dirty resident pages of mmap VMA in [START, END)
+   back to its file.  Pages are visited in address order, which is
+   file order, and each run of up to SYNC_RUN neighbouring dirty
+   pages goes out in a single write.  A run is pinned first: a
+   fault on it inside file_write_at() could otherwise wait for an
+   eviction that needs the inode lock the write holds.  Does
+   nothing for other areas. */
+static void stable_sync(struct vma *vma, uint8_t *start, uint8_t *end){
+    uint32_t *pagedir = vma->thread->pagedir;
+    uint8_t *run = start;
+    size_t cnt = 0;
 
-bool stable_less(struct hash_elem *a, struct hash_elem *b, void *aux){ 
-    return stable_hash_hash(a, aux) <stable_hash_hash(b, aux); 
+    if(vma->file == NULL || vma->mapid < 0){
+        return;
+    }
+    for(uint8_t *upage = start; ; upage += PGSIZE){
+        struct stable_entry *entry = upage < end ? stable_vma_entry(vma, upage, false) : NULL;
+        bool dirty = entry != NULL && entry->is_loaded && pagedir_is_dirty(pagedir, upage);
+        if(dirty && cnt < SYNC_RUN){
+            if(cnt++ == 0){
+                run = upage;
+            }
+            continue;
+        }
+        if(cnt > 0){
+            size_t done = run - (uint8_t *) vma->base;
+            size_t bytes = vma->read_bytes - done < cnt * PGSIZE ? vma->read_bytes - done : cnt * PGSIZE;
+            if(stable_pin(run, bytes, false)){
+                file_write_at(vma->file, run, bytes, vma->offset + done);
+                stable_unpin(run, bytes);
+                for(size_t i = 0; i < cnt; i++){
+                    pagedir_set_dirty(pagedir, run + i * PGSIZE, false);
+                }
+            }
+            cnt = 0;
+        }
+        if(dirty){
+            run = upage;
+            cnt = 1;
+            continue;
+        }
+        if(upage >= end){
+            break;
+        }
+    }
+}
+
+void stable_exit(struct vma_tree *tree){
+    struct vma *vma;
+    while((vma = tree->root) != NULL){
+        stable_unmap(vma);
+    }
+}
+
+/* Copies PARENT's areas into the current thread, a child being
+   created by fork.  Resident pages are shared copy-on-write and
+   swapped pages share their swap slot, so nothing is copied until
+   one side writes.  PARENT must not run meanwhile.  On failure
+   the partial copy is left for stable_exit() to free. */
+bool stable_fork(struct thread *parent){
+    struct thread *t = thread_current();
+
+    for(struct vma *pvma = vma_first(&parent->stable); pvma != NULL; pvma = vma_next(&parent->stable, pvma)){
+        struct vma *vma = stable_vma_alloc(pvma->base, pvma->start, pvma->end, pvma->file, pvma->offset,
+                                           pvma->read_bytes, pvma->writable, pvma->mapid);
+        if(vma == NULL){
+            return false;
+        }
+        vma_insert(&t->stable, vma);
+        for(size_t i = 0; i < pvma->chunk_cnt; i++){
+            struct stable_chunk *pchunk = pvma->chunks[i];
+            if(pchunk == NULL){
+                continue;
+            }
+            for(size_t j = 0; j < STABLE_CHUNK_PAGES; j++){
+                struct stable_entry *pentry = &pchunk->pages[j];
+                if(!pentry->is_loaded && (int) pentry->swap_index == -1 && !pentry->dirty){
+                    continue;
+                }
+                struct stable_entry *entry = stable_find_entry(t, pentry->vaddr);
+                if(entry == NULL){
+                    return false;
+                }
+                entry->dirty = pentry->dirty;
+                if(!frame_fork(pentry, entry)){
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/* Loads the pages of [UADDR, UADDR + SIZE) and pins their frames,
+   so that file I/O cannot fault on them while it holds an inode
+   lock.  If WRITE, the kernel is about to store into the range,
+   so each page is made privately writable first; otherwise pages
+   still mapped to the zero frame are left as they are.  Returns
+   false, leaving nothing pinned, if a page cannot be loaded. */
+bool stable_pin(const void *uaddr, size_t size, bool write){
+    struct thread *t = thread_current();
+    uint8_t *start = pg_round_down(uaddr);
+    uint8_t *end = (uint8_t *) uaddr + size;
+    for(uint8_t *upage = start; upage < end; upage += PGSIZE){
+        struct stable_entry *entry = stable_find_entry(t, upage);
+        bool pinned = false;
+        while(entry != NULL && !pinned){
+            if(!entry->is_loaded && !stable_frame_alloc(upage, write)){
+                break;
+            }
+            if(write && (entry->cow || entry->zero) && !stable_cow_fault(upage)){
+                break;
+            }
+            pinned = (!write && entry->zero) || frame_pin(entry);
+        }
+        if(!pinned){
+            stable_unpin(start, upage - start);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Undoes stable_pin() of the same range. */
+void stable_unpin(const void *uaddr, size_t size){
+    struct thread *t = thread_current();
+    uint8_t *end = (uint8_t *) uaddr + size;
+    for(uint8_t *upage = pg_round_down(uaddr); upage < end; upage += PGSIZE){
+        struct stable_entry *entry = stable_find_entry(t, upage);
+        if(entry != NULL && entry->frame != NULL){
+            frame_unpin(entry->frame);
+        }
+    }
 }
 
-size_t stable_hash_hash(struct hash_elem *a, void *aux){
-    struct stable_entry *entry = hash_entry(a, struct stable_entry, elem); 
-    return entry->vaddr;
-}
\ No newline at end of file
+/* Handles a write fault on a present page at ADDR: a copy-on-write
+   page gets its own copy, and a page still mapped to the zero
+   frame gets a zeroed frame of its own.  Returns false if the page
+   really is read-only, or if it lies in a large page that cannot
+   be split. */
+bool stable_cow_fault(void *addr){
+    struct thread *t = thread_current();
+    struct stable_entry *entry = stable_find_entry(t, addr);
+    if(entry == NULL || !entry->vma->writable){
+        return false;
+    }
+    if(entry->zero){
+        uint8_t *kpage = frame_kpage(PAL_ZERO);
+        pagedir_clear_page(t->pagedir, entry->vaddr);
+        entry->zero = false;
+        entry->is_loaded = false;
+        if(!pagedir_set_page(t->pagedir, entry->vaddr, kpage, true)){
+            palloc_free_page(kpage);
+            return false;
+        }
+        frame_allocate(entry, kpage);
+    }
+    else if(entry->cow){
+        if(!pagedir_demote(t->pagedir, entry->vaddr)){
+            return false;
+        }
+        frame_unshare(entry);
+    }
+    return true;
+}
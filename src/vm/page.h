@@ -1,35 +1,65 @@
 #ifndef VM_PAGE_H
 #define VM_PAGE_H
-#include <hash.h>
+#include <stdint.h>
+#include <list.h>
 #include "lib/user/syscall.h"
 #include <syscall-nr.h>
 #include "threads/vaddr.h"
 #include "threads/thread.h"
 #include "filesys/file.h"
+#include "vm/vma.h"
 
+/* State of one page of a virtual memory area.  Entries live in
+   the area's chunks; where the page comes from is described by
+   the area, so an entry only records where the page is now. */
 struct stable_entry {
+    struct vma *vma; // area containing the page
     void* vaddr; // virtual page address
-    size_t offset; // page offset
-    bool is_loaded; // Is loaded on physical memory
-    struct file * file; // File pointer for read file
-    size_t read_bytes; // To read bytes
-    size_t zero_bytes; // size of extra 0 
-    struct hash_elem elem; // hash table element
-    bool writable;
-    mapid_t mapid; // mmap id
+    struct frame_entry *frame; // resident frame, NULL when not resident
+    struct list_elem frame_elem; // element in frame_entry.sharers
     size_t swap_index; // swap index
-    bool is_swap;
-    bool used;
+    bool is_loaded; // Is loaded on physical memory
+    bool dirty; // contents no longer match the file or zero fill
+    bool cow; // shared after fork, mapped read-only until written
+    bool zero; // mapped to the shared zero frame until written
 };
 
+/* Pages per chunk; a chunk fits in one page. */
+#define STABLE_CHUNK_PAGES 128
+
+/* Entries for STABLE_CHUNK_PAGES consecutive pages of an area. */
+struct stable_chunk {
+    struct stable_entry pages[STABLE_CHUNK_PAGES];
+};
+
+/* File offset of ENTRY's page. */
+static inline off_t stable_page_offset(const struct stable_entry *entry){
+    return entry->vma->offset + ((uint8_t *) entry->vaddr - (uint8_t *) entry->vma->base);
+}
+
+/* Bytes of ENTRY's page read from the file; the rest is zeroed. */
+static inline size_t stable_page_read_bytes(const struct stable_entry *entry){
+    size_t done = (uint8_t *) entry->vaddr - (uint8_t *) entry->vma->base;
+    if(done >= entry->vma->read_bytes){
+        return 0;
+    }
+    return entry->vma->read_bytes - done < PGSIZE ? entry->vma->read_bytes - done : PGSIZE;
+}
+
 bool stable_stack_alloc(void *addr);
-struct stable_entry* stable_alloc(void* addr, struct file* file, size_t offset, size_t read_bytes, bool writable, mapid_t mapid);
-void stable_init(struct hash *table);
-bool stable_frame_alloc(void* addr);
-void stable_free(struct stable_entry *entry);
+struct vma *stable_map(void *upage, size_t page_cnt, struct file *file, off_t offset, size_t read_bytes, bool writable, mapid_t mapid);
+void stable_boot_init(size_t stack_limit, size_t stack_grow);
+void stable_init(struct vma_tree *tree);
+bool stable_frame_alloc(void* addr, bool write);
+void stable_populate(struct vma *vma, uint8_t *start, uint8_t *end);
 struct stable_entry* stable_find_entry(struct thread *t, void* addr);
 bool stable_is_exist(struct thread* t, void *addr);
 void stable_munmap(mapid_t mapping);
-void stable_exit(struct hash *hash);
-void stable_func (struct hash_elem *e, void *aux UNUSED);
+bool stable_msync(mapid_t mapping, size_t offset, size_t length);
+bool stable_madvise(void *addr, size_t length, int advice);
+void stable_exit(struct vma_tree *tree);
+bool stable_fork(struct thread *parent);
+bool stable_cow_fault(void *addr);
+bool stable_pin(const void *uaddr, size_t size, bool write);
+void stable_unpin(const void *uaddr, size_t size);
 #endif
\ No newline at end of file
@@ -1,17 +1,36 @@
 //swap.c
 #include "vm/swap.h"
+#include <stdio.h>
+#include "vm/vmstat.h"
+#include "vm/zswap.h"
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
 
 struct block *swap_block;
 struct bitmap *swap_map;
 
+static struct lock swap_lock;
+static size_t swap_cursor;	// next-fit start for slot allocation
+static uint16_t *swap_refcnt;	// entries referring to each slot, after fork
+
 #define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
 
+static size_t swap_alloc(size_t cnt);
+
 void swap_init(void){
+	lock_init(&swap_lock);
+	swap_cursor = 0;
 	swap_block = block_get_role(BLOCK_SWAP);
 	if(swap_block){
 		swap_map = bitmap_create(block_size(swap_block) / SECTORS_PER_PAGE);
 		if(swap_map){
 			bitmap_set_all(swap_map, 0);
+			swap_refcnt = calloc(bitmap_size(swap_map), sizeof *swap_refcnt);
+			if(swap_refcnt == NULL){
+				bitmap_destroy(swap_map);
+				swap_map = NULL;
+			}
 		}
 		else{
 			return;
@@ -23,11 +42,19 @@ void swap_init(void){
 }
 
 void swap_in(size_t swap_index, void * frame_page){
+	if(zswap_owns(swap_index)){
+		zswap_load(swap_index, frame_page);
+		zswap_free(swap_index);
+		return;
+	}
 	if(swap_map && swap_block){
-		bitmap_flip(swap_map, swap_index);
+		int64_t start = timer_ticks();
+		vmstat_major();
 		for(size_t i = 0; i < SECTORS_PER_PAGE; i++){
 			block_read(swap_block, swap_index * SECTORS_PER_PAGE + i, (uint8_t *) frame_page + i * BLOCK_SECTOR_SIZE);
 		}
+		vmstat_swap_in(timer_elapsed(start));
+		swap_free(swap_index);
 		return;
 	}
 	else{
@@ -36,21 +63,105 @@ void swap_in(size_t swap_index, void * frame_page){
 }
 
 size_t swap_out(void * frame_page){
-	// printf("swap out\n");
-	if(swap_map && swap_block){
-		size_t free_index = bitmap_scan_and_flip(swap_map, 0, 1, 0);
-		for(size_t i = 0; i < SECTORS_PER_PAGE; i++){
-			block_write(swap_block, free_index * SECTORS_PER_PAGE + i, (uint8_t *) frame_page + i * BLOCK_SECTOR_SIZE);
+	size_t swap_index;
+	swap_out_batch(&frame_page, 1, &swap_index);
+	return swap_index;
+}
+
+/* Writes the CNT pages in FRAME_PAGES to swap and stores the slot
+   of each page in SWAP_INDEXES, or -1 for a page that could not
+   be written.  Pages that compress well stay in RAM in the zswap
+   cache.  The others get one contiguous run of slots when there
+   is room, so the batch is written as a single sequential sweep
+   over the device and neighbouring pages can later be read back
+   together. */
+void swap_out_batch(void ** frame_pages, size_t cnt, size_t * swap_indexes){
+	size_t disk_cnt = 0;
+	for(size_t i = 0; i < cnt; i++){
+		swap_indexes[i] = zswap_store(frame_pages[i]);
+		if(swap_indexes[i] == BITMAP_ERROR){
+			disk_cnt++;
 		}
-		return free_index;
 	}
-	else{
-		return -1;
+	if(disk_cnt == 0 || !swap_map || !swap_block){
+		return;
+	}
+
+	size_t written = 0;
+	lock_acquire(&swap_lock);
+	size_t start = swap_alloc(disk_cnt);
+	for(size_t i = 0; i < cnt; i++){
+		if(swap_indexes[i] != BITMAP_ERROR){
+			continue;
+		}
+		if(start != BITMAP_ERROR){
+			swap_indexes[i] = start++;
+		}
+		else{
+			swap_indexes[i] = swap_alloc(1);
+		}
+		if(swap_indexes[i] != BITMAP_ERROR){
+			written++;
+		}
 	}
+	lock_release(&swap_lock);
+
+	int64_t begin = timer_ticks();
+	for(size_t i = 0; i < cnt; i++){
+		if(swap_indexes[i] == BITMAP_ERROR || zswap_owns(swap_indexes[i])){
+			continue;
+		}
+		for(size_t j = 0; j < SECTORS_PER_PAGE; j++){
+			block_write(swap_block, swap_indexes[i] * SECTORS_PER_PAGE + j, (uint8_t *) frame_pages[i] + j * BLOCK_SECTOR_SIZE);
+		}
+	}
+	vmstat_swap_out(written, timer_elapsed(begin));
+}
+
+/* Adds a reference to SWAP_INDEX for an entry copied by fork and
+   returns SWAP_INDEX.  The slot stays allocated until every
+   reference has been dropped with swap_free() or swap_in(). */
+size_t swap_share(size_t swap_index){
+	if(zswap_owns(swap_index)){
+		zswap_share(swap_index);
+	}
+	else if(swap_map && swap_index < bitmap_size(swap_map)){
+		lock_acquire(&swap_lock);
+		swap_refcnt[swap_index]++;
+		lock_release(&swap_lock);
+	}
+	return swap_index;
 }
 
 void swap_free(size_t swap_index){
-	if(swap_index < SECTORS_PER_PAGE && swap_index != -1){
-		bitmap_set(swap_map, swap_index, 0);
+	if(zswap_owns(swap_index)){
+		zswap_free(swap_index);
 	}
-}
\ No newline at end of file
+	else if(swap_map && swap_index < bitmap_size(swap_map)){
+		lock_acquire(&swap_lock);
+		if(--swap_refcnt[swap_index] == 0){
+			bitmap_set(swap_map, swap_index, 0);
+		}
+		lock_release(&swap_lock);
+	}
+}
+
+/* Allocates CNT contiguous slots, searching from where the last
+   allocation ended so that successive batches land next to each
+   other on disk.  Caller must hold swap_lock. */
+static size_t swap_alloc(size_t cnt){
+	size_t start = bitmap_scan_and_flip(swap_map, swap_cursor, cnt, 0);
+	if(start == BITMAP_ERROR && swap_cursor != 0){
+		start = bitmap_scan_and_flip(swap_map, 0, cnt, 0);
+	}
+	if(start != BITMAP_ERROR){
+		for(size_t i = 0; i < cnt; i++){
+			swap_refcnt[start + i] = 1;
+		}
+		swap_cursor = start + cnt;
+		if(swap_cursor >= bitmap_size(swap_map)){
+			swap_cursor = 0;
+		}
+	}
+	return start;
+}
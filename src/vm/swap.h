@@ -9,6 +9,8 @@
 void swap_init(void);
 void swap_in(size_t swap_index, void * frame_page);
 size_t swap_out(void * frame_page);
+void swap_out_batch(void ** frame_pages, size_t cnt, size_t * swap_indexes);
+size_t swap_share(size_t swap_index);
 void swap_free(size_t swap_index);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "vm/vma.h"
+#include <debug.h>
+
+static int vma_height(struct vma *node);
+static struct vma *vma_rebalance(struct vma *node);
+static struct vma *vma_insert_at(struct vma *node, struct vma *vma);
+static struct vma *vma_remove_at(struct vma *node, struct vma *vma);
+static struct vma *vma_remove_min(struct vma *node, struct vma **min);
+
+void vma_tree_init(struct vma_tree *tree){
+    tree->root = NULL;
+}
+
+/* Adds VMA to TREE.  Returns false, leaving TREE unchanged, if it
+   overlaps an area already there. */
+bool vma_insert(struct vma_tree *tree, struct vma *vma){
+    ASSERT(vma->start < vma->end);
+    if(vma_overlap(tree, vma->start, vma->end) != NULL){
+        return false;
+    }
+    tree->root = vma_insert_at(tree->root, vma);
+    return true;
+}
+
+void vma_remove(struct vma_tree *tree, struct vma *vma){
+    tree->root = vma_remove_at(tree->root, vma);
+}
+
+/* Returns the area containing ADDR, or NULL. */
+struct vma *vma_find(struct vma_tree *tree, const void *addr){
+    struct vma *node = tree->root;
+    while(node != NULL){
+        if(addr < node->start){
+            node = node->left;
+        }
+        else if(addr >= node->end){
+            node = node->right;
+        }
+        else{
+            return node;
+        }
+    }
+    return NULL;
+}
+
+/* Returns an area that overlaps [START, END), or NULL. */
+struct vma *vma_overlap(struct vma_tree *tree, const void *start, const void *end){
+    struct vma *node = tree->root;
+    while(node != NULL){
+        if(node->end <= start){
+            node = node->right;
+        }
+        else if(node->start >= end){
+            node = node->left;
+        }
+        else{
+            return node;
+        }
+    }
+    return NULL;
+}
+
+/* Returns the lowest area that ends after ADDR, or NULL.  Walking
+   on from it with vma_next() visits the areas at or above ADDR. */
+struct vma *vma_lower_bound(struct vma_tree *tree, const void *addr){
+    struct vma *node = tree->root;
+    struct vma *found = NULL;
+    while(node != NULL){
+        if(node->end > addr){
+            found = node;
+            node = node->left;
+        }
+        else{
+            node = node->right;
+        }
+    }
+    return found;
+}
+
+/* Returns the lowest area in TREE, or NULL if it is empty. */
+struct vma *vma_first(struct vma_tree *tree){
+    struct vma *node = tree->root;
+    while(node != NULL && node->left != NULL){
+        node = node->left;
+    }
+    return node;
+}
+
+/* Returns the area following VMA in address order, or NULL.  VMA
+   need not be in TREE any more, so callers may remove areas while
+   walking. */
+struct vma *vma_next(struct vma_tree *tree, struct vma *vma){
+    struct vma *node = tree->root;
+    struct vma *next = NULL;
+    while(node != NULL){
+        if(node->start > vma->start){
+            next = node;
+            node = node->left;
+        }
+        else{
+            node = node->right;
+        }
+    }
+    return next;
+}
+
+static int vma_height(struct vma *node){
+    return node != NULL ? node->height : 0;
+}
+
+static void vma_update(struct vma *node){
+    int left = vma_height(node->left);
+    int right = vma_height(node->right);
+    node->height = (left > right ? left : right) + 1;
+}
+
+static struct vma *vma_rotate_right(struct vma *node){
+    struct vma *left = node->left;
+    node->left = left->right;
+    left->right = node;
+    vma_update(node);
+    vma_update(left);
+    return left;
+}
+
+static struct vma *vma_rotate_left(struct vma *node){
+    struct vma *right = node->right;
+    node->right = right->left;
+    right->left = node;
+    vma_update(node);
+    vma_update(right);
+    return right;
+}
+
+/* Restores the AVL balance at NODE after one of its subtrees
+   changed height by one, and returns the new subtree root. */
+static struct vma *vma_rebalance(struct vma *node){
+    int balance = vma_height(node->left) - vma_height(node->right);
+    if(balance > 1){
+        if(vma_height(node->left->left) < vma_height(node->left->right)){
+            node->left = vma_rotate_left(node->left);
+        }
+        return vma_rotate_right(node);
+    }
+    if(balance < -1){
+        if(vma_height(node->right->right) < vma_height(node->right->left)){
+            node->right = vma_rotate_right(node->right);
+        }
+        return vma_rotate_left(node);
+    }
+    vma_update(node);
+    return node;
+}
+
+static struct vma *vma_insert_at(struct vma *node, struct vma *vma){
+    if(node == NULL){
+        vma->left = vma->right = NULL;
+        vma->height = 1;
+        return vma;
+    }
+    if(vma->start < node->start){
+        node->left = vma_insert_at(node->left, vma);
+    }
+    else{
+        node->right = vma_insert_at(node->right, vma);
+    }
+    return vma_rebalance(node);
+}
+
+static struct vma *vma_remove_min(struct vma *node, struct vma **min){
+    if(node->left == NULL){
+        *min = node;
+        return node->right;
+    }
+    node->left = vma_remove_min(node->left, min);
+    return vma_rebalance(node);
+}
+
+static struct vma *vma_remove_at(struct vma *node, struct vma *vma){
+    if(node == NULL){
+        return NULL;
+    }
+    if(vma->start < node->start){
+        node->left = vma_remove_at(node->left, vma);
+    }
+    else if(vma->start > node->start){
+        node->right = vma_remove_at(node->right, vma);
+    }
+    else{
+        struct vma *min;
+        if(node->right == NULL){
+            return node->left;
+        }
+        node->right = vma_remove_min(node->right, &min);
+        min->left = node->left;
+        min->right = node->right;
+        node = min;
+    }
+    return vma_rebalance(node);
+}
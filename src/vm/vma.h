@@ -0,0 +1,47 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+
+struct stable_chunk;
+
+/* A virtual memory area: one contiguous region of a process's
+   address space backed the same way, such as a segment of the
+   executable, an mmap, or the stack.  Per-page state lives in
+   chunks of stable_entries allocated on first use, so a large
+   region costs nothing until it is touched.  A process's areas
+   do not overlap and are kept in an AVL tree ordered by start. */
+struct vma {
+    void *start;        // first page, inclusive
+    void *end;          // last page, exclusive
+    void *base;         // address of page 0 in chunks; lowest start
+    struct file *file;  // backing file, NULL for anonymous memory
+    off_t offset;       // file offset of base
+    size_t read_bytes;  // bytes from base on read from the file
+    bool writable;
+    int mapid;          // mmap id, -1 for segments, -2 for the stack
+    int advice;         // MADV_NORMAL, MADV_RANDOM or MADV_SEQUENTIAL
+    struct thread *thread;  // owning process
+    struct stable_chunk **chunks;
+    size_t chunk_cnt;
+    struct vma *left, *right;   // tree links
+    int height;
+};
+
+/* The areas of one address space. */
+struct vma_tree {
+    struct vma *root;
+};
+
+void vma_tree_init(struct vma_tree *tree);
+bool vma_insert(struct vma_tree *tree, struct vma *vma);
+void vma_remove(struct vma_tree *tree, struct vma *vma);
+struct vma *vma_find(struct vma_tree *tree, const void *addr);
+struct vma *vma_overlap(struct vma_tree *tree, const void *start, const void *end);
+struct vma *vma_lower_bound(struct vma_tree *tree, const void *addr);
+struct vma *vma_first(struct vma_tree *tree);
+struct vma *vma_next(struct vma_tree *tree, struct vma *vma);
+
+#endif
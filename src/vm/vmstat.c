@@ -0,0 +1,139 @@
+//vmstat.c
+#include "vm/vmstat.h"
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Counters for all processes.  They are bumped from fault handlers,
+   the pageout thread and the swap code under different locks, so
+   updates briefly disable interrupts instead of taking one more
+   lock on the fault path. */
+static struct vmstat vmstat_total;
+
+static void vmstat_bucket(unsigned long long *hist, int64_t ticks);
+static void vmstat_print_hist(const char *name, const unsigned long long *hist);
+
+/* Starts timing a page fault taken by the current thread.  Returns
+   the start time to pass to vmstat_fault_end(). */
+int64_t vmstat_fault_begin(void){
+    thread_current()->fault_major = false;
+    return timer_ticks();
+}
+
+/* Counts a page fault started at START that has been resolved, as
+   major if vmstat_major() was called while serving it. */
+void vmstat_fault_end(int64_t start){
+    struct thread *t = thread_current();
+    int64_t ticks = timer_elapsed(start);
+    enum intr_level old_level = intr_disable();
+    if(t->fault_major){
+        t->majflt++;
+        vmstat_total.all_majflt++;
+        vmstat_bucket(vmstat_total.majflt_ticks, ticks);
+    }
+    else{
+        t->minflt++;
+        vmstat_total.all_minflt++;
+        vmstat_bucket(vmstat_total.minflt_ticks, ticks);
+    }
+    intr_set_level(old_level);
+}
+
+/* Marks the current thread's fault as major: serving it reads from
+   the file system or the swap disk. */
+void vmstat_major(void){
+    thread_current()->fault_major = true;
+}
+
+void vmstat_evict(enum vmstat_evict kind){
+    enum intr_level old_level = intr_disable();
+    switch(kind){
+    case VMSTAT_EVICT_CLEAN:
+        vmstat_total.evict_clean++;
+        break;
+    case VMSTAT_EVICT_FILE:
+        vmstat_total.evict_file++;
+        break;
+    case VMSTAT_EVICT_DIRTY:
+        vmstat_total.evict_dirty++;
+        break;
+    case VMSTAT_EVICT_SWAP:
+        vmstat_total.evict_swap++;
+        break;
+    }
+    intr_set_level(old_level);
+}
+
+/* Counts one page read from the swap disk, taking TICKS. */
+void vmstat_swap_in(int64_t ticks){
+    enum intr_level old_level = intr_disable();
+    vmstat_total.swap_in++;
+    vmstat_total.swap_in_ticks += ticks;
+    intr_set_level(old_level);
+}
+
+/* Counts CNT pages written to the swap disk, taking TICKS. */
+void vmstat_swap_out(size_t cnt, int64_t ticks){
+    enum intr_level old_level = intr_disable();
+    vmstat_total.swap_out += cnt;
+    vmstat_total.swap_out_ticks += ticks;
+    intr_set_level(old_level);
+}
+
+/* Counts an acquire of the frame table lock, which WAITED for
+   TICKS if another thread held it. */
+void vmstat_frame_lock(bool waited, int64_t ticks){
+    enum intr_level old_level = intr_disable();
+    vmstat_total.frame_lock_cnt++;
+    if(waited){
+        vmstat_total.frame_lock_waits++;
+        vmstat_total.frame_lock_ticks += ticks;
+    }
+    intr_set_level(old_level);
+}
+
+/* Copies the counters into STAT, with the current thread's own
+   fault counts.  STAT may be a user page that faults, so the
+   counters are snapshotted first and copied out with interrupts
+   on. */
+void vmstat_read(struct vmstat *stat){
+    struct thread *t = thread_current();
+    struct vmstat snapshot;
+    enum intr_level old_level = intr_disable();
+    snapshot = vmstat_total;
+    snapshot.minflt = t->minflt;
+    snapshot.majflt = t->majflt;
+    intr_set_level(old_level);
+    memcpy(stat, &snapshot, sizeof *stat);
+}
+
+void vmstat_print_stats(void){
+    printf("Faults: %llu minor, %llu major\n", vmstat_total.all_minflt, vmstat_total.all_majflt);
+    vmstat_print_hist("Minor fault ticks:", vmstat_total.minflt_ticks);
+    vmstat_print_hist("Major fault ticks:", vmstat_total.majflt_ticks);
+    printf("Evictions: %llu clean, %llu file, %llu dirty, %llu swap\n",
+           vmstat_total.evict_clean, vmstat_total.evict_file, vmstat_total.evict_dirty, vmstat_total.evict_swap);
+    printf("Swap: %llu pages written in %lld ticks, %llu pages read in %lld ticks\n",
+           vmstat_total.swap_out, vmstat_total.swap_out_ticks, vmstat_total.swap_in, vmstat_total.swap_in_ticks);
+    printf("Frame lock: %llu acquires, %llu waited for %lld ticks\n",
+           vmstat_total.frame_lock_cnt, vmstat_total.frame_lock_waits, vmstat_total.frame_lock_ticks);
+}
+
+static void vmstat_bucket(unsigned long long *hist, int64_t ticks){
+    size_t i = 0;
+    while(ticks > 0 && i < VMSTAT_BUCKETS - 1){
+        ticks >>= 1;
+        i++;
+    }
+    hist[i]++;
+}
+
+static void vmstat_print_hist(const char *name, const unsigned long long *hist){
+    printf("%s", name);
+    for(size_t i = 0; i < VMSTAT_BUCKETS; i++){
+        printf(" %llu", hist[i]);
+    }
+    printf("\n");
+}
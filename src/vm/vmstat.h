@@ -0,0 +1,28 @@
+//vmstat.h
+#ifndef VM_VMSTAT_H
+#define VM_VMSTAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "lib/user/syscall.h"
+
+/* How an evicted frame's contents were disposed of. */
+enum vmstat_evict {
+    VMSTAT_EVICT_CLEAN,     // dropped; comes back zero-filled
+    VMSTAT_EVICT_FILE,      // dropped; comes back from its file
+    VMSTAT_EVICT_DIRTY,     // written back to its file
+    VMSTAT_EVICT_SWAP       // written to swap
+};
+
+int64_t vmstat_fault_begin(void);
+void vmstat_fault_end(int64_t start);
+void vmstat_major(void);
+void vmstat_evict(enum vmstat_evict kind);
+void vmstat_swap_in(int64_t ticks);
+void vmstat_swap_out(size_t cnt, int64_t ticks);
+void vmstat_frame_lock(bool waited, int64_t ticks);
+void vmstat_read(struct vmstat *stat);
+void vmstat_print_stats(void);
+
+#endif
@@ -0,0 +1,312 @@
+//zswap.c
+#include "vm/zswap.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <round.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed swap cache.  swap_out_batch() offers each evicted page
+   here first.  A page that compresses well enough is kept in pages
+   taken from the kernel pool, up to a limit, and only the rest go
+   to the swap device.  Reading a page back is then a decompression
+   instead of eight sector reads.
+
+   Each arena page is split into ZSWAP_UNITS units, and a compressed
+   page occupies a run of units within one arena page.  Stored pages
+   are named by slot numbers offset by ZSWAP_BASE, which keeps them
+   apart from swap device slots in stable_entry.swap_index. */
+
+#define ZSWAP_BASE 0x40000000	// swap_index of slot 0
+#define ZSWAP_UNIT 128	// bytes per allocation unit
+#define ZSWAP_UNITS (PGSIZE / ZSWAP_UNIT)	// units per arena page, one bit each
+#define ZSWAP_MAX_LEN (PGSIZE * 3 / 4)	// pages compressing worse go to disk
+
+/* Compressed format: a sequence of tokens.  A byte below 0x80 is
+   followed by that many plus one literal bytes.  A byte with the
+   top bit set is a match of its low bits plus MIN_MATCH bytes, at
+   the distance given by the next two bytes, little endian. */
+#define MIN_MATCH 3
+#define MAX_MATCH (0x7f + MIN_MATCH)
+#define MAX_LITERALS 0x80
+#define HASH_BITS 10
+#define NO_POS 0xffff
+
+/* A page of the arena. */
+struct zswap_page {
+	uint8_t *kpage;	// NULL if not allocated
+	uint32_t used;	// bit per unit in use
+};
+
+/* A stored page. */
+struct zswap_slot {
+	uint16_t page;	// index in zswap_pages
+	uint8_t unit;	// first unit
+	uint8_t units;	// number of units
+	uint16_t len;	// compressed length in bytes
+	uint16_t refcnt;	// entries referring to it, 0 if free
+};
+
+static struct lock zswap_lock;
+static struct zswap_page *zswap_pages;
+static size_t zswap_page_max;	// limit on arena pages
+static size_t zswap_page_cnt;	// arena pages allocated
+static struct zswap_slot *zswap_slots;
+static size_t zswap_slot_cnt;
+static size_t zswap_cursor;	// next-fit start for slot allocation
+
+/* Compressor state, under zswap_lock. */
+static uint16_t zswap_hash[1 << HASH_BITS];
+static uint8_t zswap_buf[ZSWAP_MAX_LEN];
+
+/* Statistics, under zswap_lock. */
+static unsigned long long zswap_store_cnt;	// pages stored
+static unsigned long long zswap_load_cnt;	// pages read back
+static unsigned long long zswap_reject_cnt;	// pages that did not compress
+static unsigned long long zswap_full_cnt;	// pages that found the arena full
+static size_t zswap_bytes;	// compressed bytes held now
+
+static size_t zswap_compress(const uint8_t *src, uint8_t *dst);
+static void zswap_decompress(const uint8_t *src, size_t len, uint8_t *dst);
+static bool zswap_alloc(size_t units, size_t *page, size_t *unit);
+static struct zswap_slot *zswap_slot(size_t swap_index);
+
+/* Allows the cache to use up to MAX_PAGES pages of the kernel pool,
+   or an eighth of the size of the user pool if MAX_PAGES is 0.
+   Must run after palloc_init() and malloc_init(). */
+void zswap_init(size_t max_pages){
+	lock_init(&zswap_lock);
+	if(max_pages == 0){
+		max_pages = palloc_user_page_cnt() / 8;
+	}
+	if(max_pages > UINT16_MAX){
+		max_pages = UINT16_MAX;
+	}
+	zswap_pages = calloc(max_pages, sizeof *zswap_pages);
+	zswap_slots = calloc(max_pages * ZSWAP_UNITS, sizeof *zswap_slots);
+	if(zswap_pages == NULL || zswap_slots == NULL){
+		free(zswap_pages);
+		free(zswap_slots);
+		zswap_pages = NULL;
+		zswap_slots = NULL;
+		return;
+	}
+	zswap_page_max = max_pages;
+	zswap_slot_cnt = max_pages * ZSWAP_UNITS;
+}
+
+/* Compresses FRAME_PAGE into the cache and returns the swap_index
+   that names it, or -1 if it does not compress well or there is
+   no room. */
+size_t zswap_store(const void * frame_page){
+	size_t page, unit, i;
+	if(zswap_slot_cnt == 0){
+		return -1;
+	}
+
+	lock_acquire(&zswap_lock);
+	size_t len = zswap_compress(frame_page, zswap_buf);
+	if(len == 0){
+		zswap_reject_cnt++;
+		lock_release(&zswap_lock);
+		return -1;
+	}
+	size_t units = DIV_ROUND_UP(len, ZSWAP_UNIT);
+	for(i = 0; i < zswap_slot_cnt; i++){
+		if(zswap_slots[(zswap_cursor + i) % zswap_slot_cnt].refcnt == 0){
+			break;
+		}
+	}
+	if(i == zswap_slot_cnt || !zswap_alloc(units, &page, &unit)){
+		zswap_full_cnt++;
+		lock_release(&zswap_lock);
+		return -1;
+	}
+	size_t index = (zswap_cursor + i) % zswap_slot_cnt;
+	struct zswap_slot *slot = &zswap_slots[index];
+	slot->page = page;
+	slot->unit = unit;
+	slot->units = units;
+	slot->len = len;
+	slot->refcnt = 1;
+	memcpy(zswap_pages[page].kpage + unit * ZSWAP_UNIT, zswap_buf, len);
+	zswap_cursor = (index + 1) % zswap_slot_cnt;
+	zswap_store_cnt++;
+	zswap_bytes += len;
+	lock_release(&zswap_lock);
+	return ZSWAP_BASE + index;
+}
+
+/* Returns true if SWAP_INDEX names a page in the cache rather than
+   a slot on the swap device. */
+bool zswap_owns(size_t swap_index){
+	return swap_index >= ZSWAP_BASE && swap_index - ZSWAP_BASE < zswap_slot_cnt;
+}
+
+/* Decompresses the page SWAP_INDEX into FRAME_PAGE.  The page stays
+   in the cache until zswap_free(). */
+void zswap_load(size_t swap_index, void * frame_page){
+	lock_acquire(&zswap_lock);
+	struct zswap_slot *slot = zswap_slot(swap_index);
+	zswap_decompress(zswap_pages[slot->page].kpage + slot->unit * ZSWAP_UNIT, slot->len, frame_page);
+	zswap_load_cnt++;
+	lock_release(&zswap_lock);
+}
+
+/* Adds a reference to SWAP_INDEX for an entry copied by fork. */
+void zswap_share(size_t swap_index){
+	lock_acquire(&zswap_lock);
+	zswap_slot(swap_index)->refcnt++;
+	lock_release(&zswap_lock);
+}
+
+/* Drops a reference to SWAP_INDEX, freeing its space with the last
+   one.  An arena page with nothing left in it goes back to the
+   kernel pool. */
+void zswap_free(size_t swap_index){
+	lock_acquire(&zswap_lock);
+	struct zswap_slot *slot = zswap_slot(swap_index);
+	if(--slot->refcnt == 0){
+		struct zswap_page *page = &zswap_pages[slot->page];
+		page->used &= ~(((1u << slot->units) - 1) << slot->unit);
+		zswap_bytes -= slot->len;
+		if(page->used == 0){
+			palloc_free_page(page->kpage);
+			page->kpage = NULL;
+			zswap_page_cnt--;
+		}
+	}
+	lock_release(&zswap_lock);
+}
+
+void zswap_print_stats(void){
+	printf("Zswap: %llu pages stored, %llu loaded, %llu incompressible, %llu full, "
+	       "%zu bytes in %zu pages\n", zswap_store_cnt, zswap_load_cnt,
+	       zswap_reject_cnt, zswap_full_cnt, zswap_bytes, zswap_page_cnt);
+}
+
+static struct zswap_slot *zswap_slot(size_t swap_index){
+	ASSERT(zswap_owns(swap_index));
+	struct zswap_slot *slot = &zswap_slots[swap_index - ZSWAP_BASE];
+	ASSERT(slot->refcnt > 0);
+	return slot;
+}
+
+/* Finds UNITS free units in one arena page, adding a page if none
+   has room and the limit allows, and marks them used.  Caller must
+   hold zswap_lock. */
+static bool zswap_alloc(size_t units, size_t *page, size_t *unit){
+	uint32_t mask = (1u << units) - 1;
+	size_t empty = zswap_page_max;
+	for(size_t p = 0; p < zswap_page_max; p++){
+		if(zswap_pages[p].kpage == NULL){
+			if(empty == zswap_page_max){
+				empty = p;
+			}
+			continue;
+		}
+		for(size_t u = 0; u + units <= ZSWAP_UNITS; u++){
+			if((zswap_pages[p].used & (mask << u)) == 0){
+				zswap_pages[p].used |= mask << u;
+				*page = p;
+				*unit = u;
+				return true;
+			}
+		}
+	}
+	if(empty == zswap_page_max){
+		return false;
+	}
+	zswap_pages[empty].kpage = palloc_get_page(0);
+	if(zswap_pages[empty].kpage == NULL){
+		return false;
+	}
+	zswap_page_cnt++;
+	zswap_pages[empty].used = mask;
+	*page = empty;
+	*unit = 0;
+	return true;
+}
+
+static unsigned zswap_hash_at(const uint8_t *p){
+	uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+	return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Appends SRC[FROM..TO) to DST at *OUT as literal tokens.  Returns
+   false if that would pass ZSWAP_MAX_LEN. */
+static bool zswap_literals(const uint8_t *src, size_t from, size_t to, uint8_t *dst, size_t *out){
+	while(from < to){
+		size_t n = to - from < MAX_LITERALS ? to - from : MAX_LITERALS;
+		if(*out + 1 + n > ZSWAP_MAX_LEN){
+			return false;
+		}
+		dst[(*out)++] = n - 1;
+		memcpy(dst + *out, src + from, n);
+		*out += n;
+		from += n;
+	}
+	return true;
+}
+
+/* Compresses the page at SRC into DST.  Returns the compressed
+   length, or 0 if it would be more than ZSWAP_MAX_LEN. */
+static size_t zswap_compress(const uint8_t *src, uint8_t *dst){
+	size_t in = 0, lit = 0, out = 0;
+	memset(zswap_hash, 0xff, sizeof zswap_hash);
+	while(in + MIN_MATCH <= PGSIZE){
+		unsigned h = zswap_hash_at(src + in);
+		size_t cand = zswap_hash[h];
+		zswap_hash[h] = in;
+		if(cand == NO_POS || memcmp(src + cand, src + in, MIN_MATCH) != 0){
+			in++;
+			continue;
+		}
+		size_t len = MIN_MATCH;
+		while(len < MAX_MATCH && in + len < PGSIZE && src[cand + len] == src[in + len]){
+			len++;
+		}
+		if(!zswap_literals(src, lit, in, dst, &out) || out + 3 > ZSWAP_MAX_LEN){
+			return 0;
+		}
+		dst[out++] = 0x80 | (len - MIN_MATCH);
+		dst[out++] = (in - cand) & 0xff;
+		dst[out++] = (in - cand) >> 8;
+		in += len;
+		lit = in;
+	}
+	if(!zswap_literals(src, lit, PGSIZE, dst, &out)){
+		return 0;
+	}
+	return out;
+}
+
+/* Expands LEN bytes at SRC, made by zswap_compress(), into the page
+   at DST. */
+static void zswap_decompress(const uint8_t *src, size_t len, uint8_t *dst){
+	size_t in = 0, out = 0;
+	while(in < len){
+		uint8_t c = src[in++];
+		if(c < 0x80){
+			size_t n = c + 1;
+			ASSERT(out + n <= PGSIZE);
+			memcpy(dst + out, src + in, n);
+			in += n;
+			out += n;
+		}
+		else{
+			size_t n = (c & 0x7f) + MIN_MATCH;
+			size_t dist = src[in] | (src[in + 1] << 8);
+			in += 2;
+			ASSERT(dist > 0 && dist <= out && out + n <= PGSIZE);
+			for(size_t i = 0; i < n; i++, out++){
+				dst[out] = dst[out - dist];
+			}
+		}
+	}
+	ASSERT(out == PGSIZE);
+}
@@ -0,0 +1,16 @@
+//zswap.h
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+void zswap_init(size_t max_pages);
+size_t zswap_store(const void * frame_page);
+bool zswap_owns(size_t swap_index);
+void zswap_load(size_t swap_index, void * frame_page);
+void zswap_share(size_t swap_index);
+void zswap_free(size_t swap_index);
+void zswap_print_stats(void);
+
+#endif